@@ -0,0 +1,294 @@
+/*
+ * @title Labo beeldinterpretatie 2018: shared kernels
+ * @author Dylan Van Assche
+ *
+ * ---> BIT-PACKED BINARY MASK <---
+ *
+ * The masks of the sessions (skin, colour ranges, classifiers) are CV_8UC1 images which only contain 0 and 255: 8 bits
+ * of memory traffic for 1 bit of information. A BitMask stores 64 pixels in one word:
+ *
+ *  - AND, OR and NOT handle 64 pixels per operation.
+ *  - The area and the row projections are population counts of whole words (hal::normHamming()).
+ *  - Pipelines which only combine, clean (lib/morphology.cpp) and count masks never touch an 8 bit mask, it is only
+ *    unpacked for display or for the OpenCV functions which need one.
+ *
+ */
+#include <cstring>
+#include <opencv2/core/hal/hal.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+#include "bitmask.h"
+
+using namespace std;
+using namespace cv;
+
+// 8 bits -> 8 pixels of 0 or 255
+struct ExpandTable {
+    uint64 entries[256];
+
+    ExpandTable() {
+        for(int bits=0; bits < 256; ++bits) {
+            uchar pixels[8];
+            for(int i=0; i < 8; ++i) {
+                pixels[i] = (uchar)(bits & (1 << i) ? 255 : 0);
+            }
+            memcpy(&entries[bits], pixels, sizeof(pixels));
+        }
+    }
+};
+
+static const ExpandTable expandTable;
+
+/*
+ * Creates an empty BitMask (all pixels 0).
+ *
+ * @param BitMask mask output
+ * @param int rows
+ * @param int cols
+ * @author Dylan Van Assche
+ */
+void createBitMask(BitMask &mask, int rows, int cols) {
+    CV_Assert(rows >= 0 && cols >= 0);
+    mask.rows = rows;
+    mask.cols = cols;
+    mask.words = (cols + BIT_MASK_WORD_BITS - 1) / BIT_MASK_WORD_BITS;
+    mask.bits.assign((size_t)rows * mask.words, 0);
+}
+
+/*
+ * Packs a row of 8 bit pixels to one bit per pixel, every non-zero pixel is set. Kernels which produce a mask row by
+ * row can pack each row while it is still in the cache.
+ *
+ * @param const uchar* pixel, cols pixels
+ * @param int cols
+ * @param uint64* word output, (cols + 63) / 64 words
+ * @author Dylan Van Assche
+ */
+void packBitMaskRow(const uchar *pixel, int cols, uint64 *word) {
+    int x = 0;
+
+#if CV_SIMD128
+    v_uint8x16 zero = v_setzero_u8();
+    for(; x <= cols - BIT_MASK_WORD_BITS; x += BIT_MASK_WORD_BITS) {
+        uint64 bits = 0;
+        for(int i=0; i < BIT_MASK_WORD_BITS; i += v_uint8x16::nlanes) {
+            bits |= (uint64)(unsigned)v_signmask(v_load(pixel + x + i) != zero) << i;
+        }
+        word[x / BIT_MASK_WORD_BITS] = bits;
+    }
+#endif
+
+    for(; x < cols; x += BIT_MASK_WORD_BITS) {
+        int count = min(BIT_MASK_WORD_BITS, cols - x);
+        uint64 bits = 0;
+        for(int i=0; i < count; ++i) {
+            bits |= (uint64)(pixel[x + i] != 0) << i;
+        }
+        word[x / BIT_MASK_WORD_BITS] = bits;
+    }
+}
+
+/*
+ * Packs a CV_8UC1 mask to one bit per pixel, every non-zero pixel is set.
+ *
+ * @param Mat mask, CV_8UC1
+ * @param BitMask packed output
+ * @author Dylan Van Assche
+ */
+void packBitMask(const Mat &mask, BitMask &packed) {
+    CV_Assert(mask.type() == CV_8UC1);
+    packed.rows = mask.rows;
+    packed.cols = mask.cols;
+    packed.words = (mask.cols + BIT_MASK_WORD_BITS - 1) / BIT_MASK_WORD_BITS;
+    packed.bits.resize((size_t)packed.rows * packed.words);
+
+    for(int y=0; y < mask.rows; ++y) {
+        packBitMaskRow(mask.ptr<uchar>(y), mask.cols, &packed.bits[(size_t)y * packed.words]);
+    }
+}
+
+/*
+ * Unpacks a BitMask to a CV_8UC1 mask with 0 and 255.
+ *
+ * @param BitMask packed
+ * @param Mat mask output
+ * @author Dylan Van Assche
+ */
+void unpackBitMask(const BitMask &packed, Mat &mask) {
+    mask.create(packed.rows, packed.cols, CV_8UC1);
+    for(int y=0; y < packed.rows; ++y) {
+        const uint64 *word = &packed.bits[(size_t)y * packed.words];
+        uchar *pixel = mask.ptr<uchar>(y);
+        int x = 0;
+        for(; x <= packed.cols - BIT_MASK_WORD_BITS; x += BIT_MASK_WORD_BITS) {
+            uint64 bits = word[x / BIT_MASK_WORD_BITS];
+            for(int i=0; i < BIT_MASK_WORD_BITS; i += 8) {
+                memcpy(pixel + x + i, &expandTable.entries[(bits >> i) & 0xFF], 8);
+            }
+        }
+        for(; x < packed.cols; x += 8) {
+            uint64 bits = word[x / BIT_MASK_WORD_BITS] >> (x % BIT_MASK_WORD_BITS);
+            memcpy(pixel + x, &expandTable.entries[bits & 0xFF], min(8, packed.cols - x));
+        }
+    }
+}
+
+/*
+ * Pixels set in both masks.
+ *
+ * @param BitMask a
+ * @param BitMask b, same size as a
+ * @param BitMask result output, may be a or b
+ * @author Dylan Van Assche
+ */
+void andBitMask(const BitMask &a, const BitMask &b, BitMask &result) {
+    CV_Assert(a.rows == b.rows && a.cols == b.cols);
+    result.rows = a.rows;
+    result.cols = a.cols;
+    result.words = a.words;
+    result.bits.resize(a.bits.size());
+    for(size_t i=0; i < result.bits.size(); ++i) {
+        result.bits[i] = a.bits[i] & b.bits[i];
+    }
+}
+
+/*
+ * Pixels set in at least one of the masks.
+ *
+ * @param BitMask a
+ * @param BitMask b, same size as a
+ * @param BitMask result output, may be a or b
+ * @author Dylan Van Assche
+ */
+void orBitMask(const BitMask &a, const BitMask &b, BitMask &result) {
+    CV_Assert(a.rows == b.rows && a.cols == b.cols);
+    result.rows = a.rows;
+    result.cols = a.cols;
+    result.words = a.words;
+    result.bits.resize(a.bits.size());
+    for(size_t i=0; i < result.bits.size(); ++i) {
+        result.bits[i] = a.bits[i] | b.bits[i];
+    }
+}
+
+/*
+ * Inverts a mask, the bits after the last column stay 0.
+ *
+ * @param BitMask mask
+ * @param BitMask result output, may be mask
+ * @author Dylan Van Assche
+ */
+void notBitMask(const BitMask &mask, BitMask &result) {
+    if(&result != &mask) {
+        result = mask;
+    }
+    int used = mask.cols - (mask.words - 1) * BIT_MASK_WORD_BITS;
+    uint64 last = used < BIT_MASK_WORD_BITS ? ~(~(uint64)0 << used) : ~(uint64)0;
+    for(int y=0; y < result.rows; ++y) {
+        uint64 *word = &result.bits[(size_t)y * result.words];
+        for(int i=0; i < result.words; ++i) {
+            word[i] = ~word[i];
+        }
+        word[result.words - 1] &= last;
+    }
+}
+
+/*
+ * Number of pixels set, same as countNonZero() on the unpacked mask.
+ *
+ * @param BitMask mask
+ * @returns int area
+ * @author Dylan Van Assche
+ */
+int countBitMask(const BitMask &mask) {
+    if(mask.bits.empty()) {
+        return 0;
+    }
+    return hal::normHamming((const uchar *)&mask.bits[0], (int)(mask.bits.size() * sizeof(uint64)));
+}
+
+/*
+ * Number of pixels set in every row (horizontal projection).
+ *
+ * @param BitMask mask
+ * @param vector<int> counts output, one per row
+ * @author Dylan Van Assche
+ */
+void projectBitMaskRows(const BitMask &mask, vector<int> &counts) {
+    counts.resize(mask.rows);
+    for(int y=0; y < mask.rows; ++y) {
+        counts[y] = mask.words > 0 ? hal::normHamming((const uchar *)&mask.bits[(size_t)y * mask.words], mask.words * (int)sizeof(uint64)) : 0;
+    }
+}
+
+/*
+ * Number of pixels set in every column (vertical projection). Empty bytes are skipped, so sparse masks are cheap.
+ *
+ * @param BitMask mask
+ * @param vector<int> counts output, one per column
+ * @author Dylan Van Assche
+ */
+void projectBitMaskColumns(const BitMask &mask, vector<int> &counts) {
+    // One extra word of counters, the unused bits are 0 anyway
+    vector<int> padded((size_t)mask.words * BIT_MASK_WORD_BITS, 0);
+    for(int y=0; y < mask.rows; ++y) {
+        const uint64 *word = &mask.bits[(size_t)y * mask.words];
+        for(int i=0; i < mask.words; ++i) {
+            for(int byte=0; byte < 8 && (word[i] >> (8 * byte)) != 0; ++byte) {
+                unsigned int bits = (unsigned int)(word[i] >> (8 * byte)) & 0xFF;
+                int *count = &padded[(size_t)i * BIT_MASK_WORD_BITS + 8 * byte];
+                for(int j=0; j < 8; ++j) {
+                    count[j] += (bits >> j) & 1;
+                }
+            }
+        }
+    }
+    counts.assign(padded.begin(), padded.begin() + mask.cols);
+}
+
+/*
+ * Copies the pixels of an image where the mask is set, same as image.copyTo(output, mask) with the unpacked mask: the
+ * other pixels of output are kept, output is reallocated and cleared when it has another size or type.
+ *
+ * @param Mat image, CV_8U with any number of channels
+ * @param BitMask mask, same size as image
+ * @param Mat output
+ * @author Dylan Van Assche
+ */
+void copyWithBitMask(const Mat &image, const BitMask &mask, Mat &output) {
+    CV_Assert(image.depth() == CV_8U && image.rows == mask.rows && image.cols == mask.cols);
+    if(image.data == output.data) {
+        return;
+    }
+    if(output.size() != image.size() || output.type() != image.type()) {
+        output = Mat::zeros(image.size(), image.type());
+    }
+
+    size_t pixelSize = image.elemSize();
+    for(int y=0; y < image.rows; ++y) {
+        const uint64 *word = &mask.bits[(size_t)y * mask.words];
+        const uchar *source = image.ptr<uchar>(y);
+        uchar *destination = output.ptr<uchar>(y);
+        for(int i=0; i < mask.words; ++i) {
+            uint64 bits = word[i];
+            int x = i * BIT_MASK_WORD_BITS;
+
+            // Full words are one block copy, mixed words are copied per run of set pixels
+            if(bits == ~(uint64)0) {
+                memcpy(destination + x * pixelSize, source + x * pixelSize, BIT_MASK_WORD_BITS * pixelSize);
+                continue;
+            }
+            while(bits) {
+                int start = 0;
+                while(!((bits >> start) & 1)) {
+                    ++start;
+                }
+                int end = start;
+                while(end < BIT_MASK_WORD_BITS && ((bits >> end) & 1)) {
+                    ++end;
+                }
+                memcpy(destination + (x + start) * pixelSize, source + (x + start) * pixelSize, (end - start) * pixelSize);
+                bits = end < BIT_MASK_WORD_BITS ? bits & (~(uint64)0 << end) : 0;
+            }
+        }
+    }
+}
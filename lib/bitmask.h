@@ -0,0 +1,33 @@
+#ifndef BITMASK_H
+#define BITMASK_H
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+// Bit-packed binary mask
+#define BIT_MASK_WORD_BITS 64 // pixels per word
+
+/*
+ * One bit per pixel: bit x % 64 of word x / 64 of a row is pixel x. Every row starts at a new word and the bits after
+ * the last column are always 0, so whole words can be combined and counted.
+ */
+typedef struct BitMask {
+    int rows;
+    int cols;
+    int words; // per row
+    std::vector<uint64> bits;
+} BitMask;
+
+void createBitMask(BitMask &mask, int rows, int cols);
+void packBitMaskRow(const uchar *pixel, int cols, uint64 *word);
+void packBitMask(const cv::Mat &mask, BitMask &packed);
+void unpackBitMask(const BitMask &packed, cv::Mat &mask);
+void andBitMask(const BitMask &a, const BitMask &b, BitMask &result);
+void orBitMask(const BitMask &a, const BitMask &b, BitMask &result);
+void notBitMask(const BitMask &mask, BitMask &result);
+int countBitMask(const BitMask &mask);
+void projectBitMaskRows(const BitMask &mask, std::vector<int> &counts);
+void projectBitMaskColumns(const BitMask &mask, std::vector<int> &counts);
+void copyWithBitMask(const cv::Mat &image, const BitMask &mask, cv::Mat &output);
+
+#endif //BITMASK_H
@@ -0,0 +1,58 @@
+/*
+ * @title Labo beeldinterpretatie 2018: shared kernels
+ * @author Dylan Van Assche
+ *
+ * ---> LARGEST BLOB <---
+ *
+ * Searching the largest contour by comparing contourArea(contours[i]) with the area of the current winner recomputes
+ * the area of the winner and its convex hull over and over, on noisy masks with thousands of contours that adds up.
+ * connectedComponentsWithStats() labels the mask and measures the area, bounding box and centroid of every blob in
+ * one pass, the largest blob is then a linear search over the statistics and only its hull is computed.
+ *
+ */
+#include "blobs.h"
+
+using namespace std;
+using namespace cv;
+
+/*
+ * Finds the largest blob (most pixels) of a binary mask and computes its convex hull.
+ *
+ * @param Mat mask, CV_8UC1, non-zero = foreground
+ * @param Blob blob output
+ * @returns bool false if the mask has no foreground pixels
+ * @author Dylan Van Assche
+ */
+bool findLargestBlob(const Mat &mask, Blob &blob) {
+    CV_Assert(mask.type() == CV_8UC1);
+    Mat labels, stats, centroids;
+    int count = connectedComponentsWithStats(mask, labels, stats, centroids, BLOB_CONNECTIVITY, CV_32S);
+
+    // Label 0 is the background
+    int largest = 0;
+    for(int label=1; label < count; ++label) {
+        if(largest == 0 || stats.at<int>(label, CC_STAT_AREA) > stats.at<int>(largest, CC_STAT_AREA)) {
+            largest = label;
+        }
+    }
+    if(largest == 0) {
+        return false;
+    }
+
+    blob.area = stats.at<int>(largest, CC_STAT_AREA);
+    blob.box = Rect(stats.at<int>(largest, CC_STAT_LEFT), stats.at<int>(largest, CC_STAT_TOP),
+                    stats.at<int>(largest, CC_STAT_WIDTH), stats.at<int>(largest, CC_STAT_HEIGHT));
+    blob.centroid = Point2d(centroids.at<double>(largest, 0), centroids.at<double>(largest, 1));
+
+    // Hull of the winner only: its outer contour within its bounding box
+    Mat component = labels(blob.box) == largest;
+    vector< vector<Point> > contours;
+    findContours(component, contours, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE, blob.box.tl());
+    vector<Point> points;
+    for(size_t i=0; i < contours.size(); ++i) {
+        points.insert(points.end(), contours[i].begin(), contours[i].end());
+    }
+    convexHull(points, blob.hull);
+
+    return true;
+}
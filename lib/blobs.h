@@ -0,0 +1,19 @@
+#ifndef BLOBS_H
+#define BLOBS_H
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+// Blob connectivity, same as the contours of findContours()
+#define BLOB_CONNECTIVITY 8
+
+typedef struct Blob {
+    int area; // pixels
+    cv::Rect box;
+    cv::Point2d centroid;
+    std::vector<cv::Point> hull;
+} Blob;
+
+bool findLargestBlob(const cv::Mat &mask, Blob &blob);
+
+#endif //BLOBS_H
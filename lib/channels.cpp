@@ -0,0 +1,93 @@
+/*
+ * @title Labo beeldinterpretatie 2018: shared kernels
+ * @author Dylan Van Assche
+ *
+ * ---> CHANNELS AND GREY IN ONE PASS <---
+ *
+ * split() followed by cvtColor(COLOR_BGR2GRAY) reads the colour image twice. The kernel below reads every pixel once,
+ * deinterleaves it into its B, G and R values in registers and writes the 3 planes and the grey value together.
+ *
+ */
+#include <opencv2/core/hal/intrin.hpp>
+#include "channels.h"
+
+using namespace cv;
+
+#if CV_SIMD128
+/*
+ * Private function to compute the luma of 8 pixels with 16 bit dot products: (B, G) pairs with (GREY_BLUE, GREY_GREEN)
+ * and (R, 1) pairs with (GREY_RED, rounding).
+ *
+ * @param v_uint16x8 blue
+ * @param v_uint16x8 green
+ * @param v_uint16x8 red
+ * @returns v_int16x8 grey
+ * @author Dylan Van Assche
+ */
+static inline v_int16x8 _luma(const v_uint16x8 &blue, const v_uint16x8 &green, const v_uint16x8 &red) {
+    // Lanes are little endian: the low 16 bits are the first coefficient of the pair
+    v_int16x8 blueGreen = v_reinterpret_as_s16(v_setall_s32(GREY_BLUE | (GREY_GREEN << 16)));
+    v_int16x8 redRound = v_reinterpret_as_s16(v_setall_s32(GREY_RED | ((1 << (GREY_SHIFT - 1)) << 16)));
+    v_uint16x8 one = v_setall_u16(1);
+
+    v_uint16x8 bg0, bg1, r0, r1;
+    v_zip(blue, green, bg0, bg1);
+    v_zip(red, one, r0, r1);
+    v_int32x4 grey0 = v_dotprod(v_reinterpret_as_s16(bg0), blueGreen) + v_dotprod(v_reinterpret_as_s16(r0), redRound);
+    v_int32x4 grey1 = v_dotprod(v_reinterpret_as_s16(bg1), blueGreen) + v_dotprod(v_reinterpret_as_s16(r1), redRound);
+    return v_pack(grey0 >> GREY_SHIFT, grey1 >> GREY_SHIFT);
+}
+#endif
+
+/*
+ * Splits a BGR image into its 3 channel planes and computes its grey image in a single pass, the results are the same
+ * as split() and cvtColor(COLOR_BGR2GRAY). 16 pixels are processed at a time with the OpenCV universal intrinsics,
+ * the remaining pixels of a row and builds without SIMD support use the scalar formula.
+ *
+ * @param Mat bgr, CV_8UC3
+ * @param Mat[3] planes, CV_8UC1 output: blue, green, red
+ * @param Mat grey, CV_8UC1 output
+ * @author Dylan Van Assche
+ */
+void splitGrey(const Mat &bgr, Mat planes[3], Mat &grey) {
+    CV_Assert(bgr.type() == CV_8UC3);
+    for(int c=0; c < 3; ++c) {
+        planes[c].create(bgr.size(), CV_8UC1);
+    }
+    grey.create(bgr.size(), CV_8UC1);
+
+    for(int y=0; y < bgr.rows; ++y) {
+        const uchar *pixel = bgr.ptr<uchar>(y);
+        uchar *blue = planes[0].ptr<uchar>(y);
+        uchar *green = planes[1].ptr<uchar>(y);
+        uchar *red = planes[2].ptr<uchar>(y);
+        uchar *luma = grey.ptr<uchar>(y);
+        int x = 0;
+
+#if CV_SIMD128
+        for(; x <= bgr.cols - v_uint8x16::nlanes; x += v_uint8x16::nlanes) {
+            v_uint8x16 b, g, r;
+            v_load_deinterleave(pixel + 3 * x, b, g, r);
+            v_store(blue + x, b);
+            v_store(green + x, g);
+            v_store(red + x, r);
+
+            v_uint16x8 b0, b1, g0, g1, r0, r1;
+            v_expand(b, b0, b1);
+            v_expand(g, g0, g1);
+            v_expand(r, r0, r1);
+            v_store(luma + x, v_pack_u(_luma(b0, g0, r0), _luma(b1, g1, r1)));
+        }
+#endif
+
+        for(; x < bgr.cols; ++x) {
+            int b = pixel[3 * x];
+            int g = pixel[3 * x + 1];
+            int r = pixel[3 * x + 2];
+            blue[x] = (uchar)b;
+            green[x] = (uchar)g;
+            red[x] = (uchar)r;
+            luma[x] = (uchar)((b * GREY_BLUE + g * GREY_GREEN + r * GREY_RED + (1 << (GREY_SHIFT - 1))) >> GREY_SHIFT);
+        }
+    }
+}
@@ -0,0 +1,14 @@
+#ifndef CHANNELS_H
+#define CHANNELS_H
+
+#include <opencv2/opencv.hpp>
+
+// Fixed point luma of cv::cvtColor(COLOR_BGR2GRAY) for 8 bit images: 0.114 B + 0.587 G + 0.299 R
+#define GREY_SHIFT 14
+#define GREY_BLUE 1868
+#define GREY_GREEN 9617
+#define GREY_RED 4899
+
+void splitGrey(const cv::Mat &bgr, cv::Mat planes[3], cv::Mat &grey);
+
+#endif //CHANNELS_H
@@ -0,0 +1,283 @@
+/*
+ * @title Labo beeldinterpretatie 2018: shared kernels
+ * @author Dylan Van Assche
+ *
+ * ---> TEMPORAL CLAHE <---
+ *
+ * CLAHE (Contrast Limited Adaptive Histogram Equalization) computes a clipped histogram equalization LUT for every
+ * tile and interpolates bilinearly between the LUTs of the 4 nearest tiles for every pixel. In a video most of the
+ * image doesn't change between 2 frames, so the work of the previous frame can be reused:
+ *
+ *  - The tile histograms are updated with the pixels that changed instead of being rebuilt.
+ *  - The LUT of a tile is only recomputed when enough of its pixels changed, and it moves to the new LUT over a few
+ *    frames (exponential smoothing) to avoid flicker.
+ *  - The interpolation only runs for the pixels that changed and for the pixels near a tile whose LUT changed, all
+ *    other pixels keep the result of the previous frame.
+ *
+ * The tiles, clip limit and interpolation follow cv::CLAHE: a frame whose size isn't a multiple of the number of tiles
+ * is padded at the right and bottom with BORDER_REFLECT_101, so all tiles have the same size.
+ *
+ */
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include "clahe.h"
+
+using namespace std;
+using namespace cv;
+
+#define HISTOGRAM_SIZE 256
+
+/*
+ * Initializes a temporal CLAHE, the state is created by the first frame.
+ *
+ * @param TemporalClahe clahe output
+ * @param double clipLimit, same meaning as in cv::CLAHE
+ * @param Size tiles, number of tiles horizontally and vertically
+ * @author Dylan Van Assche
+ */
+void initTemporalClahe(TemporalClahe &clahe, double clipLimit, Size tiles) {
+    CV_Assert(tiles.width > 0 && tiles.height > 0);
+    clahe.clipLimit = clipLimit;
+    clahe.tiles = tiles;
+    clahe.noiseLevel = CLAHE_NOISE_LEVEL;
+    clahe.lutThreshold = CLAHE_LUT_THRESHOLD;
+    clahe.smoothing = CLAHE_SMOOTHING;
+    clahe.padded.release();
+    clahe.reference.release();
+    clahe.changed.release();
+    clahe.result.release();
+}
+
+/*
+ * Private function to compute the equalization LUT of a tile from its histogram, like cv::CLAHE: the histogram is
+ * clipped and the clipped pixels are redistributed over all bins before the cumulative histogram is scaled to 0-255.
+ *
+ * @param const int* histogram, HISTOGRAM_SIZE bins
+ * @param int area, number of pixels in the tile
+ * @param double clipLimit
+ * @param float* lut output, HISTOGRAM_SIZE entries
+ * @author Dylan Van Assche
+ */
+void _computeTileLut(const int *histogram, int area, double clipLimit, float *lut) {
+    int clipped[HISTOGRAM_SIZE];
+    int limit = clipLimit > 0 ? max((int)(clipLimit * area / HISTOGRAM_SIZE), 1) : area;
+    int excess = 0;
+
+    for(int i=0; i < HISTOGRAM_SIZE; ++i) {
+        clipped[i] = histogram[i];
+        if(clipped[i] > limit) {
+            excess += clipped[i] - limit;
+            clipped[i] = limit;
+        }
+    }
+
+    int batch = excess / HISTOGRAM_SIZE;
+    int residual = excess - batch * HISTOGRAM_SIZE;
+    for(int i=0; i < HISTOGRAM_SIZE; ++i) {
+        clipped[i] += batch;
+    }
+    if(residual > 0) {
+        int step = max(HISTOGRAM_SIZE / residual, 1);
+        for(int i=0; i < HISTOGRAM_SIZE && residual > 0; i += step, --residual) {
+            clipped[i]++;
+        }
+    }
+
+    float scale = 255.0f / max(area, 1);
+    int sum = 0;
+    for(int i=0; i < HISTOGRAM_SIZE; ++i) {
+        sum += clipped[i];
+        lut[i] = min(sum * scale, 255.0f);
+    }
+}
+
+/*
+ * Applies the temporal CLAHE to the next frame of a video. The first frame (or a frame with another size) is
+ * equalized completely and sizes all buffers, the next frames only update what changed.
+ *
+ * @param TemporalClahe clahe
+ * @param Mat grey, CV_8UC1
+ * @param Mat output, shares its data with the state: read only and valid until the next call
+ * @author Dylan Van Assche
+ */
+void applyTemporalClahe(TemporalClahe &clahe, const Mat &grey, Mat &output) {
+    CV_Assert(grey.type() == CV_8UC1);
+    int tilesX = clahe.tiles.width;
+    int tilesY = clahe.tiles.height;
+    int tileCount = tilesX * tilesY;
+    bool first = clahe.result.size() != grey.size();
+
+    // Equal tiles: pad the frame to a multiple of the tiles like cv::CLAHE
+    Mat source = grey;
+    if(grey.cols % tilesX != 0 || grey.rows % tilesY != 0) {
+        copyMakeBorder(grey, clahe.padded, 0, (tilesY - grey.rows % tilesY) % tilesY, 0,
+                       (tilesX - grey.cols % tilesX) % tilesX, BORDER_REFLECT_101);
+        source = clahe.padded;
+    }
+    int tileWidth = source.cols / tilesX;
+    int tileHeight = source.rows / tilesY;
+    int area = tileWidth * tileHeight;
+
+    if(first) {
+        source.copyTo(clahe.reference);
+        clahe.changed = Mat::zeros(source.size(), CV_8UC1);
+        clahe.result.create(grey.size(), CV_8UC1);
+        clahe.tileSize = Size(tileWidth, tileHeight);
+        clahe.histograms.assign(tileCount * HISTOGRAM_SIZE, 0);
+        clahe.changedPixels.assign(tileCount, 0);
+        clahe.targetLuts.assign(tileCount * HISTOGRAM_SIZE, 0.0f);
+        clahe.smoothLuts.assign(tileCount * HISTOGRAM_SIZE, 0.0f);
+        clahe.luts.assign(tileCount * HISTOGRAM_SIZE, 0);
+        clahe.dirty.assign(tileCount, 1);
+        clahe.dirtyCell.resize((tilesY + 1) * (tilesX + 1));
+
+        // Tile of every column
+        clahe.columnTile.resize(source.cols);
+        for(int x=0; x < source.cols; ++x) {
+            clahe.columnTile[x] = x / tileWidth;
+        }
+
+        // Interpolation between the 2 nearest tile centres of every column, as in cv::CLAHE
+        float invTileWidth = 1.0f / tileWidth;
+        clahe.tileX1.resize(grey.cols);
+        clahe.tileX2.resize(grey.cols);
+        clahe.cellX.resize(grey.cols);
+        clahe.weightX.resize(grey.cols);
+        for(int x=0; x < grey.cols; ++x) {
+            float txf = x * invTileWidth - 0.5f;
+            int tx = cvFloor(txf);
+            clahe.weightX[x] = txf - tx;
+            clahe.cellX[x] = tx + 1;
+            clahe.tileX1[x] = max(tx, 0) * HISTOGRAM_SIZE;
+            clahe.tileX2[x] = min(tx + 1, tilesX - 1) * HISTOGRAM_SIZE;
+        }
+    }
+    const int *columnTile = &clahe.columnTile[0];
+
+    /*
+     * 1. Update the reference image and the tile histograms with the pixels that changed more than the noise level.
+     *    The padding belongs to the tiles too, its pixels change with the pixels they reflect.
+     */
+    clahe.rowChanged.assign(source.rows, first ? 1 : 0);
+    for(int ty=0; ty < tilesY; ++ty) {
+        int *histogramRow = &clahe.histograms[ty * tilesX * HISTOGRAM_SIZE];
+        int *changedRow = &clahe.changedPixels[ty * tilesX];
+
+        for(int y=ty * tileHeight; y < (ty + 1) * tileHeight; ++y) {
+            const uchar *current = source.ptr<uchar>(y);
+            uchar *reference = clahe.reference.ptr<uchar>(y);
+            uchar *changed = clahe.changed.ptr<uchar>(y);
+
+            if(first) {
+                for(int x=0; x < source.cols; ++x) {
+                    histogramRow[columnTile[x] * HISTOGRAM_SIZE + current[x]]++;
+                }
+                continue;
+            }
+
+            // Most rows of a static scene are identical
+            if(memcmp(current, reference, source.cols) == 0) {
+                memset(changed, 0, source.cols);
+                continue;
+            }
+
+            for(int x=0; x < source.cols; ++x) {
+                if(abs(current[x] - reference[x]) > clahe.noiseLevel) {
+                    int *histogram = histogramRow + columnTile[x] * HISTOGRAM_SIZE;
+                    histogram[reference[x]]--;
+                    histogram[current[x]]++;
+                    changedRow[columnTile[x]]++;
+                    reference[x] = current[x];
+                    changed[x] = 1;
+                    clahe.rowChanged[y] = 1;
+                }
+                else {
+                    changed[x] = 0;
+                }
+            }
+        }
+    }
+
+    /*
+     * 2. Recompute the LUT of the tiles that changed enough and move every LUT towards its target.
+     */
+    for(int t=0; t < tileCount; ++t) {
+        float *target = &clahe.targetLuts[t * HISTOGRAM_SIZE];
+        float *smooth = &clahe.smoothLuts[t * HISTOGRAM_SIZE];
+        uchar *lut = &clahe.luts[t * HISTOGRAM_SIZE];
+
+        if(first || clahe.changedPixels[t] > clahe.lutThreshold * area) {
+            _computeTileLut(&clahe.histograms[t * HISTOGRAM_SIZE], area, clahe.clipLimit, target);
+            clahe.changedPixels[t] = 0;
+        }
+
+        clahe.dirty[t] = first ? 1 : 0;
+        for(int i=0; i < HISTOGRAM_SIZE; ++i) {
+            float value = first ? target[i] : smooth[i] + (float)clahe.smoothing * (target[i] - smooth[i]);
+            if(fabs(target[i] - value) < 0.5f) {
+                value = target[i];
+            }
+            smooth[i] = value;
+
+            uchar rounded = saturate_cast<uchar>(value);
+            if(rounded != lut[i]) {
+                lut[i] = rounded;
+                clahe.dirty[t] = 1;
+            }
+        }
+    }
+
+    /*
+     * 3. Bilinear interpolation between the LUTs of the 4 nearest tiles, as in cv::CLAHE. The pixels between the same
+     *    4 tile centres form a cell, a cell must be recomputed completely when one of its tiles has a new LUT. Only the
+     *    pixels of the frame are interpolated, not the padding.
+     */
+    for(int cy=0; cy <= tilesY; ++cy) {
+        for(int cx=0; cx <= tilesX; ++cx) {
+            int y1 = max(cy - 1, 0), y2 = min(cy, tilesY - 1);
+            int x1 = max(cx - 1, 0), x2 = min(cx, tilesX - 1);
+            clahe.dirtyCell[cy * (tilesX + 1) + cx] = clahe.dirty[y1 * tilesX + x1] | clahe.dirty[y1 * tilesX + x2]
+                                                      | clahe.dirty[y2 * tilesX + x1] | clahe.dirty[y2 * tilesX + x2];
+        }
+    }
+
+    const int *tileX1 = &clahe.tileX1[0];
+    const int *tileX2 = &clahe.tileX2[0];
+    const int *cellX = &clahe.cellX[0];
+    const float *weightX = &clahe.weightX[0];
+    float invTileHeight = 1.0f / tileHeight;
+    for(int y=0; y < grey.rows; ++y) {
+        float tyf = y * invTileHeight - 0.5f;
+        int ty = cvFloor(tyf);
+        float ya = tyf - ty;
+        const uchar *dirtyRow = &clahe.dirtyCell[(ty + 1) * (tilesX + 1)];
+        const uchar *lutRow1 = &clahe.luts[max(ty, 0) * tilesX * HISTOGRAM_SIZE];
+        const uchar *lutRow2 = &clahe.luts[min(ty + 1, tilesY - 1) * tilesX * HISTOGRAM_SIZE];
+
+        bool anyDirty = false;
+        for(int cx=0; cx <= tilesX; ++cx) {
+            anyDirty = anyDirty || dirtyRow[cx];
+        }
+        if(!anyDirty && !clahe.rowChanged[y]) {
+            continue;
+        }
+
+        const uchar *reference = clahe.reference.ptr<uchar>(y);
+        const uchar *changed = clahe.changed.ptr<uchar>(y);
+        uchar *result = clahe.result.ptr<uchar>(y);
+        for(int x=0; x < grey.cols; ++x) {
+            if(!dirtyRow[cellX[x]] && !changed[x]) {
+                continue;
+            }
+
+            int value = reference[x];
+            float xa = weightX[x];
+            float top = lutRow1[tileX1[x] + value] * (1.0f - xa) + lutRow1[tileX2[x] + value] * xa;
+            float bottom = lutRow2[tileX1[x] + value] * (1.0f - xa) + lutRow2[tileX2[x] + value] * xa;
+            result[x] = saturate_cast<uchar>(top * (1.0f - ya) + bottom * ya);
+        }
+    }
+
+    output = clahe.result;
+}
@@ -0,0 +1,43 @@
+#ifndef CLAHE_H
+#define CLAHE_H
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+// Temporal CLAHE for video
+#define CLAHE_NOISE_LEVEL 2 // grey level changes up to this value are treated as sensor noise
+#define CLAHE_LUT_THRESHOLD 0.02 // fraction of the pixels of a tile that must change before its LUT is recomputed
+#define CLAHE_SMOOTHING 0.5 // weight of the new LUT, the rest comes from the LUT of the previous frame
+
+/*
+ * State of a temporal CLAHE. The histograms and LUTs of the tiles and the previous result are kept between frames.
+ * Only the pixels which changed more than noiseLevel and the pixels near a tile whose LUT changed are recomputed.
+ * All buffers are sized by the first frame, the next frames of the same size don't allocate.
+ */
+typedef struct TemporalClahe {
+    double clipLimit;
+    cv::Size tiles;
+    int noiseLevel;
+    double lutThreshold;
+    double smoothing;
+    cv::Mat padded; // frame extended to a multiple of the tiles with BORDER_REFLECT_101, like cv::CLAHE
+    cv::Mat reference; // last accepted grey value of every pixel of the padded frame
+    cv::Mat changed; // pixels which changed in the current frame
+    cv::Mat result;
+    cv::Size tileSize; // all tiles have the same size in the padded frame
+    std::vector<int> histograms; // 256 bins per tile
+    std::vector<int> changedPixels; // per tile, since its last LUT computation
+    std::vector<float> targetLuts, smoothLuts; // 256 entries per tile
+    std::vector<uchar> luts; // 256 entries per tile, rounded smoothLuts
+    std::vector<uchar> dirty; // per tile, LUT changed in the current frame
+    std::vector<int> columnTile; // tile of every column of the padded frame
+    std::vector<uchar> rowChanged; // per row, a pixel changed in the current frame
+    std::vector<int> tileX1, tileX2, cellX; // per column: LUT offsets of the left and right tile, interpolation cell
+    std::vector<float> weightX; // per column: weight of the right tile
+    std::vector<uchar> dirtyCell; // per cell between 4 tile centres, a LUT changed in the current frame
+} TemporalClahe;
+
+void initTemporalClahe(TemporalClahe &clahe, double clipLimit, cv::Size tiles);
+void applyTemporalClahe(TemporalClahe &clahe, const cv::Mat &grey, cv::Mat &output);
+
+#endif //CLAHE_H
@@ -0,0 +1,331 @@
+/*
+ * @title Labo beeldinterpretatie 2018: shared kernels
+ * @author Dylan Van Assche
+ *
+ * ---> COLOUR LOOKUP TABLE <---
+ *
+ * Every pixel classifier of the sessions (the RGB skin rule of sessie 1, the HSV ranges of sessie 2 and the trained
+ * classifiers of sessie 5) only depends on the B, G and R value of the pixel. Such a classifier can be evaluated once
+ * for every colour and stored as one bit per colour: 256^3 bits = 2 MB. Segmenting an image is then a single table
+ * lookup per pixel, whatever the cost of the original rule. Expensive classifiers are compiled on a quantized colour
+ * cube (2^bits levels per channel) to keep the number of evaluations low.
+ *
+ */
+#include <fstream>
+#include <cstring>
+#include "colorlut.h"
+
+using namespace std;
+using namespace cv;
+
+// Classifies a row of BGR colours (1 x N, CV_8UC3) into labels (1 x N, CV_8UC1, non-zero = inside)
+typedef void (*ColorClassifier)(const Mat &colors, Mat &labels, void *userData);
+
+typedef struct ColorRuleData {
+    ColorRule rule;
+    void *userData;
+} ColorRuleData;
+
+typedef struct ColorRangeData {
+    const vector<Scalar> *lower;
+    const vector<Scalar> *upper;
+    int colorConversion;
+} ColorRangeData;
+
+typedef struct ColorModelData {
+    const Ptr<ml::StatModel> *classifier;
+    int colorConversion;
+} ColorModelData;
+
+/*
+ * Private function which fills the table of a LUT by classifying the centre colour of every cell. The colour cube is
+ * classified one blue level at a time, so the classifier can work on a whole slice of colours at once.
+ *
+ * @param ColorLut lut
+ * @param int bits
+ * @param ColorClassifier classify
+ * @param void* userData
+ * @author Dylan Van Assche
+ */
+void _compileColorLut(ColorLut &lut, int bits, ColorClassifier classify, void *userData) {
+    CV_Assert(bits >= 1 && bits <= COLOR_LUT_FULL_BITS);
+    int levels = 1 << bits;
+    int shift = COLOR_LUT_FULL_BITS - bits;
+    int centre = shift > 0 ? 1 << (shift - 1) : 0;
+    int sliceSize = levels * levels;
+
+    lut.bits = bits;
+    lut.key = 0;
+    lut.table.assign(((size_t)sliceSize * levels + 7) / 8, 0);
+
+    Mat colors(1, sliceSize, CV_8UC3);
+    Mat labels;
+    for(int b=0; b < levels; ++b) {
+        Vec3b *color = colors.ptr<Vec3b>(0);
+        for(int g=0; g < levels; ++g) {
+            for(int r=0; r < levels; ++r) {
+                *color++ = Vec3b((uchar)((b << shift) | centre), (uchar)((g << shift) | centre), (uchar)((r << shift) | centre));
+            }
+        }
+
+        classify(colors, labels, userData);
+        CV_Assert(labels.type() == CV_8UC1 && (int)labels.total() == sliceSize);
+
+        const uchar *label = labels.ptr<uchar>(0);
+        size_t base = (size_t)b * sliceSize;
+        for(int i=0; i < sliceSize; ++i) {
+            if(label[i]) {
+                lut.table[(base + i) >> 3] |= (uchar)(1 << ((base + i) & 7));
+            }
+        }
+    }
+}
+
+// ColorClassifier for a ColorRule
+void _classifyRule(const Mat &colors, Mat &labels, void *userData) {
+    ColorRuleData *data = (ColorRuleData *)userData;
+    labels.create(colors.size(), CV_8UC1);
+    const Vec3b *color = colors.ptr<Vec3b>(0);
+    uchar *label = labels.ptr<uchar>(0);
+    for(int i=0; i < colors.cols; ++i) {
+        label[i] = data->rule(color[i][0], color[i][1], color[i][2], data->userData) ? 255 : 0;
+    }
+}
+
+// ColorClassifier for a union of inRange() boxes in a converted colour space
+void _classifyRanges(const Mat &colors, Mat &labels, void *userData) {
+    ColorRangeData *data = (ColorRangeData *)userData;
+    Mat converted = colors;
+    if(data->colorConversion != COLOR_LUT_NO_CONVERSION) {
+        cvtColor(colors, converted, data->colorConversion);
+    }
+
+    labels = Mat::zeros(colors.size(), CV_8UC1);
+    Mat inside;
+    for(size_t i=0; i < data->lower->size(); ++i) {
+        inRange(converted, data->lower->at(i), data->upper->at(i), inside);
+        bitwise_or(labels, inside, labels);
+    }
+}
+
+// ColorClassifier for a trained OpenCV classifier, all colours of the slice are predicted in one call
+void _classifyModel(const Mat &colors, Mat &labels, void *userData) {
+    ColorModelData *data = (ColorModelData *)userData;
+    Mat converted = colors;
+    if(data->colorConversion != COLOR_LUT_NO_CONVERSION) {
+        cvtColor(colors, converted, data->colorConversion);
+    }
+
+    // 1 x N, 3 channels -> N x 3 samples, one per row (ml::ROW_SAMPLE)
+    Mat samples, predictions;
+    converted.reshape(1, (int)converted.total()).convertTo(samples, CV_32F);
+    (*data->classifier)->predict(samples, predictions);
+
+    // Labels are CV_32F or CV_32S depending on the classifier
+    compare(predictions, 0, labels, CMP_NE);
+    labels = labels.reshape(1, 1);
+}
+
+/*
+ * Compiles a rule on the BGR values of a pixel into a LUT.
+ *
+ * @param ColorLut lut output
+ * @param ColorRule rule
+ * @param void* userData passed to the rule
+ * @param int bits per channel, COLOR_LUT_FULL_BITS for an exact table
+ * @author Dylan Van Assche
+ */
+void compileColorLut(ColorLut &lut, ColorRule rule, void *userData, int bits) {
+    ColorRuleData data;
+    data.rule = rule;
+    data.userData = userData;
+    _compileColorLut(lut, bits, _classifyRule, &data);
+}
+
+/*
+ * Compiles a union of inRange() boxes into a LUT. The boxes are defined in the colour space of colorConversion (for
+ * example COLOR_BGR2HSV), the LUT is indexed with BGR values so the conversion disappears from the segmentation.
+ *
+ * @param ColorLut lut output
+ * @param vector<Scalar> lower bounds of each box
+ * @param vector<Scalar> upper bounds of each box
+ * @param int colorConversion cvtColor() code or COLOR_LUT_NO_CONVERSION
+ * @param int bits per channel, COLOR_LUT_FULL_BITS for an exact table
+ * @author Dylan Van Assche
+ */
+void compileColorLut(ColorLut &lut, const vector<Scalar> &lower, const vector<Scalar> &upper, int colorConversion, int bits) {
+    CV_Assert(lower.size() == upper.size());
+    ColorRangeData data;
+    data.lower = &lower;
+    data.upper = &upper;
+    data.colorConversion = colorConversion;
+    _compileColorLut(lut, bits, _classifyRanges, &data);
+    lut.key = colorLutKey(lower, upper, colorConversion, bits);
+}
+
+/*
+ * Key of a LUT compiled from a union of inRange() boxes: FNV-1a hash of the bounds, the colour conversion and the bits.
+ * A cached LUT can be checked against the ranges without compiling them.
+ *
+ * @param vector<Scalar> lower bounds of each box
+ * @param vector<Scalar> upper bounds of each box
+ * @param int colorConversion cvtColor() code or COLOR_LUT_NO_CONVERSION
+ * @param int bits per channel
+ * @returns unsigned int key, never 0
+ * @author Dylan Van Assche
+ */
+unsigned int colorLutKey(const vector<Scalar> &lower, const vector<Scalar> &upper, int colorConversion, int bits) {
+    CV_Assert(lower.size() == upper.size());
+    vector<int> values;
+    values.push_back(colorConversion);
+    values.push_back(bits);
+    for(size_t i=0; i < lower.size(); ++i) {
+        for(int c=0; c < 3; ++c) {
+            values.push_back(cvRound(lower[i][c]));
+            values.push_back(cvRound(upper[i][c]));
+        }
+    }
+
+    unsigned int hash = 2166136261u;
+    const uchar *bytes = (const uchar *)&values[0];
+    for(size_t i=0; i < values.size() * sizeof(int); ++i) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash == 0 ? 1 : hash;
+}
+
+/*
+ * Compiles a trained classifier (KNN, Naive Bayes, SVM, ...) into a LUT. The samples of the classifier are the 3
+ * channels of a pixel after colorConversion, as floats. Every colour cell costs one prediction, use a quantized LUT
+ * for slow classifiers.
+ *
+ * @param ColorLut lut output
+ * @param Ptr<ml::StatModel> classifier, trained
+ * @param int colorConversion cvtColor() code or COLOR_LUT_NO_CONVERSION
+ * @param int bits per channel
+ * @author Dylan Van Assche
+ */
+void compileColorLut(ColorLut &lut, const Ptr<ml::StatModel> &classifier, int colorConversion, int bits) {
+    ColorModelData data;
+    data.classifier = &classifier;
+    data.colorConversion = colorConversion;
+    _compileColorLut(lut, bits, _classifyModel, &data);
+}
+
+/*
+ * Segments a BGR image with a LUT: one table lookup per pixel.
+ *
+ * @param ColorLut lut
+ * @param Mat bgr, CV_8UC3
+ * @param Mat mask, CV_8UC1 output (255 = inside, 0 = outside)
+ * @author Dylan Van Assche
+ */
+void applyColorLut(const ColorLut &lut, const Mat &bgr, Mat &mask) {
+    CV_Assert(bgr.type() == CV_8UC3 && !lut.table.empty());
+    mask.create(bgr.size(), CV_8UC1);
+    int shift = COLOR_LUT_FULL_BITS - lut.bits;
+    const uchar *table = &lut.table[0];
+
+    for(int y=0; y < bgr.rows; ++y) {
+        const uchar *pixel = bgr.ptr<uchar>(y);
+        uchar *inside = mask.ptr<uchar>(y);
+        for(int x=0; x < bgr.cols; ++x, pixel += 3) {
+            unsigned int index = ((unsigned int)(pixel[0] >> shift) << (2 * lut.bits))
+                                 | ((unsigned int)(pixel[1] >> shift) << lut.bits)
+                                 | (unsigned int)(pixel[2] >> shift);
+            inside[x] = (uchar)(0 - ((table[index >> 3] >> (index & 7)) & 1));
+        }
+    }
+}
+
+/*
+ * Segments a BGR image with a LUT straight into a BitMask, the 8 bit labels only exist for one row at a time.
+ *
+ * @param ColorLut lut
+ * @param Mat bgr, CV_8UC3
+ * @param BitMask mask output
+ * @author Dylan Van Assche
+ */
+void applyColorLut(const ColorLut &lut, const Mat &bgr, BitMask &mask) {
+    CV_Assert(bgr.type() == CV_8UC3 && !lut.table.empty());
+    createBitMask(mask, bgr.rows, bgr.cols);
+    int shift = COLOR_LUT_FULL_BITS - lut.bits;
+    const uchar *table = &lut.table[0];
+
+    // One row of 8 bit labels, packed while it is in the cache
+    vector<uchar> row(bgr.cols);
+    for(int y=0; y < bgr.rows; ++y) {
+        const uchar *pixel = bgr.ptr<uchar>(y);
+        for(int x=0; x < bgr.cols; ++x, pixel += 3) {
+            unsigned int index = ((unsigned int)(pixel[0] >> shift) << (2 * lut.bits))
+                                 | ((unsigned int)(pixel[1] >> shift) << lut.bits)
+                                 | (unsigned int)(pixel[2] >> shift);
+            row[x] = (uchar)((table[index >> 3] >> (index & 7)) & 1);
+        }
+        if(bgr.cols > 0) {
+            packBitMaskRow(&row[0], bgr.cols, &mask.bits[(size_t)y * mask.words]);
+        }
+    }
+}
+
+/*
+ * Saves a LUT as a binary file: magic, version, bits per channel, key (little endian) and the packed table.
+ *
+ * @param string path
+ * @param ColorLut lut
+ * @returns bool true on success
+ * @author Dylan Van Assche
+ */
+bool saveColorLut(const string &path, const ColorLut &lut) {
+    ofstream file(path.c_str(), ios::binary);
+    if(!file) {
+        return false;
+    }
+
+    char header[10];
+    memcpy(header, COLOR_LUT_MAGIC, 4);
+    header[4] = COLOR_LUT_VERSION;
+    header[5] = (char)lut.bits;
+    for(int i=0; i < 4; ++i) {
+        header[6 + i] = (char)(lut.key >> (8 * i));
+    }
+    file.write(header, sizeof(header));
+    file.write((const char *)&lut.table[0], lut.table.size());
+    return file.good();
+}
+
+/*
+ * Loads a LUT saved by saveColorLut(). Files of an older version or compiled from other ranges are rejected.
+ *
+ * @param string path
+ * @param ColorLut lut output
+ * @param unsigned int key, expected key (see colorLutKey()), 0 accepts any key
+ * @returns bool true on success, false if the file is missing, not a valid LUT or has another key
+ * @author Dylan Van Assche
+ */
+bool loadColorLut(const string &path, ColorLut &lut, unsigned int key) {
+    ifstream file(path.c_str(), ios::binary);
+    char header[10];
+    if(!file || !file.read(header, sizeof(header))) {
+        return false;
+    }
+
+    int bits = header[5];
+    if(memcmp(header, COLOR_LUT_MAGIC, 4) != 0 || header[4] != COLOR_LUT_VERSION || bits < 1 || bits > COLOR_LUT_FULL_BITS) {
+        return false;
+    }
+
+    unsigned int fileKey = 0;
+    for(int i=0; i < 4; ++i) {
+        fileKey |= (unsigned int)(uchar)header[6 + i] << (8 * i);
+    }
+    if(key != 0 && fileKey != key) {
+        return false;
+    }
+
+    lut.bits = bits;
+    lut.key = fileKey;
+    lut.table.resize((((size_t)1 << (3 * bits)) + 7) / 8);
+    file.read((char *)&lut.table[0], lut.table.size());
+    return !file.fail();
+}
@@ -0,0 +1,38 @@
+#ifndef COLORLUT_H
+#define COLORLUT_H
+
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "bitmask.h"
+
+// Colour lookup table classifier
+#define COLOR_LUT_FULL_BITS 8 // 256 levels per channel: 256^3 colours, 2 MB bit-packed
+#define COLOR_LUT_NO_CONVERSION -1 // classify the BGR values themselves
+#define COLOR_LUT_MAGIC "CLUT"
+#define COLOR_LUT_VERSION 2 // 2: key of the compiled ranges in the header
+
+/*
+ * One bit per colour cell: B, G and R are quantized to 2^bits levels each and the cell of a pixel is at
+ * (B << 2*bits) | (G << bits) | R in the packed table. The key identifies the ranges the table was compiled from
+ * (see colorLutKey()), 0 for rules and classifiers.
+ */
+typedef struct ColorLut {
+    int bits;
+    unsigned int key;
+    std::vector<uchar> table;
+} ColorLut;
+
+// Colour rule on the BGR values of a pixel, userData is passed through from compileColorLut()
+typedef bool (*ColorRule)(uchar blue, uchar green, uchar red, void *userData);
+
+void compileColorLut(ColorLut &lut, ColorRule rule, void *userData, int bits = COLOR_LUT_FULL_BITS);
+void compileColorLut(ColorLut &lut, const std::vector<cv::Scalar> &lower, const std::vector<cv::Scalar> &upper, int colorConversion, int bits = COLOR_LUT_FULL_BITS);
+void compileColorLut(ColorLut &lut, const cv::Ptr<cv::ml::StatModel> &classifier, int colorConversion, int bits);
+void applyColorLut(const ColorLut &lut, const cv::Mat &bgr, cv::Mat &mask);
+void applyColorLut(const ColorLut &lut, const cv::Mat &bgr, BitMask &mask);
+unsigned int colorLutKey(const std::vector<cv::Scalar> &lower, const std::vector<cv::Scalar> &upper, int colorConversion, int bits = COLOR_LUT_FULL_BITS);
+bool saveColorLut(const std::string &path, const ColorLut &lut);
+bool loadColorLut(const std::string &path, ColorLut &lut, unsigned int key = 0);
+
+#endif //COLORLUT_H
@@ -0,0 +1,155 @@
+/*
+ * @title Labo beeldinterpretatie 2018: shared kernels
+ * @author Dylan Van Assche
+ *
+ * ---> CIRCULAR HUE RANGE <---
+ *
+ * Red lies on both ends of the hue axis, so segmenting red with inRange() takes 2 passes (0 - 5 and 165 - 180) and a
+ * third pass to merge both masks. A hue interval which is allowed to wrap around tests both ends in the same pass:
+ *
+ *  wrapped:     H >= lowH || H <= highH
+ *  not wrapped: H >= lowH && H <= highH
+ *
+ * Both ends of a wrapped range can have another lower value bound, like the 2 inRange() boxes of sessie 2.
+ *
+ */
+#include <opencv2/core/hal/intrin.hpp>
+#include "huerange.h"
+
+using namespace std;
+using namespace cv;
+
+/*
+ * Creates a HueRange, lowH > highH wraps around the end of the hue axis.
+ *
+ * @param int lowH, 0 - 179
+ * @param int highH, 0 - 179
+ * @param int lowS
+ * @param int highS
+ * @param int lowV, of lowH - 179 for a wrapped range
+ * @param int highV
+ * @param int wrappedLowV, lowV of 0 - highH for a wrapped range, -1 = lowV
+ * @returns HueRange
+ * @author Dylan Van Assche
+ */
+HueRange createHueRange(int lowH, int highH, int lowS, int highS, int lowV, int highV, int wrappedLowV) {
+    HueRange range;
+    range.lowH = lowH;
+    range.highH = highH;
+    range.lowS = lowS;
+    range.highS = highS;
+    range.lowV = lowV;
+    range.highV = highV;
+    range.wrappedLowV = wrappedLowV < 0 ? lowV : wrappedLowV;
+    return range;
+}
+
+/*
+ * Private function which splits a hue range into inRange() boxes: 2 boxes for a wrapped range, 1 box otherwise.
+ *
+ * @param HueRange range
+ * @param vector<Scalar> lower bounds output
+ * @param vector<Scalar> upper bounds output
+ * @author Dylan Van Assche
+ */
+void _hueRangeBoxes(const HueRange &range, vector<Scalar> &lower, vector<Scalar> &upper) {
+    if(range.lowH > range.highH) {
+        lower.push_back(Scalar(range.lowH, range.lowS, range.lowV));
+        upper.push_back(Scalar(HUE_RANGE_MAX, range.highS, range.highV));
+        lower.push_back(Scalar(0, range.lowS, range.wrappedLowV));
+        upper.push_back(Scalar(range.highH, range.highS, range.highV));
+    }
+    else {
+        lower.push_back(Scalar(range.lowH, range.lowS, range.lowV));
+        upper.push_back(Scalar(range.highH, range.highS, range.highV));
+    }
+}
+
+/*
+ * Segments an HSV image with a circular hue range in a single pass (255 = inside, 0 = outside). Each row is
+ * deinterleaved into H, S and V in registers and 16 pixels are tested at a time with the OpenCV universal intrinsics,
+ * the remaining pixels of a row and builds without SIMD support use the scalar test.
+ *
+ * @param Mat hsv, CV_8UC3
+ * @param HueRange range
+ * @param Mat mask, CV_8UC1 output
+ * @author Dylan Van Assche
+ */
+void hueRangeMask(const Mat &hsv, const HueRange &range, Mat &mask) {
+    CV_Assert(hsv.type() == CV_8UC3);
+    mask.create(hsv.size(), CV_8UC1);
+    bool wrapped = range.lowH > range.highH;
+
+    // Bounds outside 0 - 255 can't be stored in a uchar lane
+    int lowH = max(range.lowH, 0), highH = min(range.highH, 255);
+    int lowS = max(range.lowS, 0), highS = min(range.highS, 255);
+    int lowV = max(range.lowV, 0), highV = min(range.highV, 255);
+    int wrappedLowV = wrapped ? max(range.wrappedLowV, 0) : lowV;
+
+    for(int y=0; y < hsv.rows; ++y) {
+        const uchar *pixel = hsv.ptr<uchar>(y);
+        uchar *inside = mask.ptr<uchar>(y);
+        int x = 0;
+
+#if CV_SIMD128
+        v_uint8x16 minHue = v_setall_u8((uchar)lowH), maxHue = v_setall_u8((uchar)highH);
+        v_uint8x16 minSaturation = v_setall_u8((uchar)lowS), maxSaturation = v_setall_u8((uchar)highS);
+        v_uint8x16 minValue = v_setall_u8((uchar)lowV), maxValue = v_setall_u8((uchar)highV);
+        v_uint8x16 minWrappedValue = v_setall_u8((uchar)wrappedLowV);
+
+        for(; x <= hsv.cols - v_uint8x16::nlanes; x += v_uint8x16::nlanes) {
+            v_uint8x16 hue, saturation, value;
+            v_load_deinterleave(pixel + 3 * x, hue, saturation, value);
+
+            v_uint8x16 hueInside;
+            if(wrapped) {
+                hueInside = ((hue >= minHue) & (value >= minValue)) | ((hue <= maxHue) & (value >= minWrappedValue));
+            }
+            else {
+                hueInside = (hue >= minHue) & (hue <= maxHue) & (value >= minValue);
+            }
+            v_uint8x16 result = hueInside & (saturation >= minSaturation) & (saturation <= maxSaturation)
+                                & (value <= maxValue);
+            v_store(inside + x, result);
+        }
+#endif
+
+        for(; x < hsv.cols; ++x) {
+            int hue = pixel[3 * x];
+            int saturation = pixel[3 * x + 1];
+            int value = pixel[3 * x + 2];
+            bool hueInside = wrapped ? (hue >= lowH && value >= lowV) || (hue <= highH && value >= wrappedLowV)
+                                     : hue >= lowH && hue <= highH && value >= lowV;
+            bool result = hueInside && saturation >= lowS && saturation <= highS && value <= highV;
+            inside[x] = result ? 255 : 0;
+        }
+    }
+}
+
+/*
+ * Compiles a circular hue range into a colour lookup table indexed with BGR values: the BGR to HSV conversion and
+ * the range test become a single table lookup per pixel (see colorlut.cpp).
+ *
+ * @param ColorLut lut output
+ * @param HueRange range
+ * @author Dylan Van Assche
+ */
+void compileHueRangeLut(ColorLut &lut, const HueRange &range) {
+    vector<Scalar> lower, upper;
+    _hueRangeBoxes(range, lower, upper);
+    compileColorLut(lut, lower, upper, COLOR_BGR2HSV);
+}
+
+/*
+ * Key of the LUT compileHueRangeLut() compiles for a range, without compiling it. A cached LUT with another key was
+ * compiled for another range.
+ *
+ * @param HueRange range
+ * @returns unsigned int key
+ * @author Dylan Van Assche
+ */
+unsigned int hueRangeLutKey(const HueRange &range) {
+    vector<Scalar> lower, upper;
+    _hueRangeBoxes(range, lower, upper);
+    return colorLutKey(lower, upper, COLOR_BGR2HSV);
+}
@@ -0,0 +1,27 @@
+#ifndef HUERANGE_H
+#define HUERANGE_H
+
+#include <opencv2/opencv.hpp>
+#include "colorlut.h"
+
+// OpenCV 8 bit hue: 0 - 179 (degrees / 2)
+#define HUE_RANGE_MAX 180
+
+/*
+ * HSV range with a circular hue interval: lowH <= highH selects lowH - highH, lowH > highH wraps around red and
+ * selects lowH - 179 and 0 - highH. Saturation and value are normal intervals. All bounds are inclusive.
+ * The 0 - highH part of a wrapped range has its own lower value bound, wrappedLowV.
+ */
+typedef struct HueRange {
+    int lowH, highH;
+    int lowS, highS;
+    int lowV, highV;
+    int wrappedLowV;
+} HueRange;
+
+HueRange createHueRange(int lowH, int highH, int lowS, int highS, int lowV, int highV, int wrappedLowV = -1);
+void hueRangeMask(const cv::Mat &hsv, const HueRange &range, cv::Mat &mask);
+void compileHueRangeLut(ColorLut &lut, const HueRange &range);
+unsigned int hueRangeLutKey(const HueRange &range);
+
+#endif //HUERANGE_H
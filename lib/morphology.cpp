@@ -0,0 +1,293 @@
+/*
+ * @title Labo beeldinterpretatie 2018: shared kernels
+ * @author Dylan Van Assche
+ *
+ * ---> BINARY MORPHOLOGY <---
+ *
+ * The sessions clean their masks with erode() and dilate() using the default 3x3 kernel and 2 - 5 iterations, every
+ * iteration is a full pass over the image. For a rectangle kernel N iterations are the same as one pass with a
+ * (2N+1)x(2N+1) rectangle (the border pixels are ignored in both cases), and a rectangle is separable: a vertical
+ * min/max over 2N+1 rows followed by a horizontal min/max over 2N+1 columns.
+ *
+ * On a 0/255 mask min and max are AND and OR, so the mask is packed to one bit per pixel (lib/bitmask.cpp):
+ *
+ *  - vertical: running AND/OR over 2N+1 rows, 3 operations per word for any N (van Herk / Gil-Werman)
+ *  - horizontal: AND/OR of the word shifted by 1 ... N bits to both sides, with the bits of the neighbouring words
+ *
+ * The horizontal kernel is a template on the radius, so the shift loop is unrolled for every iteration count up to
+ * MORPH_SPECIALISED_ITER.
+ * Opening and closing stay packed between the erosion and the dilation. The result equals erode()/dilate() with
+ * Mat() as kernel for masks which only contain 0 and 255 (any non-zero pixel is treated as 255).
+ *
+ */
+#include <cstring>
+#include "morphology.h"
+
+using namespace std;
+using namespace cv;
+
+// Erosion: a pixel stays set when all pixels under the kernel are set, pixels outside the image don't count
+struct ErodeOp {
+    static inline uint64 combine(uint64 a, uint64 b) { return a & b; }
+    static inline uint64 outside() { return ~(uint64)0; }
+};
+
+// Dilation: a pixel is set when any pixel under the kernel is set
+struct DilateOp {
+    static inline uint64 combine(uint64 a, uint64 b) { return a | b; }
+    static inline uint64 outside() { return 0; }
+};
+
+// Per thread buffers, reused between calls so the steady state doesn't allocate
+typedef struct MorphWorkspace {
+    BitMask packed;
+    BitMask buffer;
+    vector<uint64> prefix, suffix; // vertical pass
+    vector<uint64> row; // horizontal pass
+} MorphWorkspace;
+
+static TLSData<MorphWorkspace> morphWorkspaces;
+
+/*
+ * Private function for the vertical pass: every row becomes the AND/OR of the rows within radius. The rows are split in
+ * blocks of 2 * radius + 1 rows (van Herk / Gil-Werman): a window always covers the end of one block and the start of
+ * the next, so it is the combination of a suffix and a prefix of those blocks, 3 operations per word for any radius.
+ *
+ * @param BitMask input
+ * @param BitMask output
+ * @param vector<uint64> prefix buffer
+ * @param vector<uint64> suffix buffer
+ * @param int radius
+ * @author Dylan Van Assche
+ */
+template<class Op>
+void _morphVertical(const BitMask &input, BitMask &output, vector<uint64> &prefix, vector<uint64> &suffix, int radius) {
+    int words = input.words;
+    int window = 2 * radius + 1;
+    int padded = input.rows + 2 * radius; // radius rows outside the image above and below
+    output.rows = input.rows;
+    output.cols = input.cols;
+    output.words = words;
+    output.bits.resize(input.bits.size());
+    prefix.resize((size_t)padded * words);
+    suffix.resize((size_t)padded * words);
+
+    vector<uint64> outside(words, Op::outside());
+    vector<const uint64 *> rows(padded);
+    for(int j=0; j < padded; ++j) {
+        int y = j - radius;
+        rows[j] = y >= 0 && y < input.rows ? &input.bits[(size_t)y * words] : &outside[0];
+    }
+
+    for(int j=0; j < padded; ++j) {
+        uint64 *result = &prefix[(size_t)j * words];
+        if(j % window == 0) {
+            memcpy(result, rows[j], words * sizeof(uint64));
+            continue;
+        }
+        const uint64 *previous = result - words;
+        for(int i=0; i < words; ++i) {
+            result[i] = Op::combine(previous[i], rows[j][i]);
+        }
+    }
+
+    for(int j=padded - 1; j >= 0; --j) {
+        uint64 *result = &suffix[(size_t)j * words];
+        if(j % window == window - 1 || j == padded - 1) {
+            memcpy(result, rows[j], words * sizeof(uint64));
+            continue;
+        }
+        const uint64 *next = result + words;
+        for(int i=0; i < words; ++i) {
+            result[i] = Op::combine(next[i], rows[j][i]);
+        }
+    }
+
+    // Window of output row y: padded rows y ... y + window - 1
+    for(int y=0; y < input.rows; ++y) {
+        const uint64 *start = &suffix[(size_t)y * words];
+        const uint64 *end = &prefix[(size_t)(y + window - 1) * words];
+        uint64 *result = &output.bits[(size_t)y * words];
+        for(int i=0; i < words; ++i) {
+            result[i] = Op::combine(start[i], end[i]);
+        }
+    }
+}
+
+/*
+ * Private function for the horizontal pass: every pixel becomes the AND/OR of the pixels within RADIUS in its row.
+ * RADIUS is a compile-time constant, so the shift loop is unrolled. Input and output may be the same mask.
+ *
+ * @param BitMask input
+ * @param BitMask output
+ * @param vector<uint64> row buffer
+ * @author Dylan Van Assche
+ */
+template<class Op, int RADIUS>
+void _morphHorizontal(const BitMask &input, BitMask &output, vector<uint64> &row) {
+    int words = input.words;
+    int used = input.cols - (words - 1) * BIT_MASK_WORD_BITS;
+    uint64 unused = used < BIT_MASK_WORD_BITS ? ~(uint64)0 << used : 0;
+    if(words == 0) {
+        return;
+    }
+
+    // Row with one word outside the image on both sides, the unused bits of the last word are outside as well
+    row.assign(words + 2, Op::outside());
+    for(int y=0; y < input.rows; ++y) {
+        memcpy(&row[1], &input.bits[(size_t)y * words], words * sizeof(uint64));
+        row[words] = (row[words] & ~unused) | (Op::outside() & unused);
+
+        // No dependency between the words: the compiler can vectorize this loop
+        const uint64 *word = &row[1];
+        uint64 *result = &output.bits[(size_t)y * words];
+        for(int i=0; i < words; ++i) {
+            uint64 previous = word[i - 1], current = word[i], next = word[i + 1];
+            uint64 value = current;
+            for(int k=1; k <= RADIUS; ++k) {
+                value = Op::combine(value, (current >> k) | (next << (BIT_MASK_WORD_BITS - k)));
+                value = Op::combine(value, (current << k) | (previous >> (BIT_MASK_WORD_BITS - k)));
+            }
+            result[i] = value;
+        }
+        result[words - 1] &= ~unused;
+    }
+}
+
+/*
+ * Private function for N iterations of the 3x3 erosion or dilation on a packed mask, in place: one vertical pass with
+ * radius N and horizontal passes of at most MORPH_SPECIALISED_ITER (a window of radius a followed by a window of
+ * radius b is a window of radius a + b).
+ *
+ * @param BitMask mask
+ * @param MorphWorkspace workspace, buffers of the passes
+ * @param int iterations
+ * @author Dylan Van Assche
+ */
+template<class Op>
+void _morphPacked(BitMask &mask, MorphWorkspace &workspace, int iterations) {
+    if(iterations <= 0) {
+        return;
+    }
+    _morphVertical<Op>(mask, workspace.buffer, workspace.prefix, workspace.suffix, iterations);
+
+    const BitMask *input = &workspace.buffer;
+    for(int remaining=iterations; remaining > 0; remaining -= MORPH_SPECIALISED_ITER) {
+        switch(min(remaining, MORPH_SPECIALISED_ITER)) {
+            case 1: _morphHorizontal<Op, 1>(*input, mask, workspace.row); break;
+            case 2: _morphHorizontal<Op, 2>(*input, mask, workspace.row); break;
+            case 3: _morphHorizontal<Op, 3>(*input, mask, workspace.row); break;
+            case 4: _morphHorizontal<Op, 4>(*input, mask, workspace.row); break;
+            case 5: _morphHorizontal<Op, 5>(*input, mask, workspace.row); break;
+            case 6: _morphHorizontal<Op, 6>(*input, mask, workspace.row); break;
+            case 7: _morphHorizontal<Op, 7>(*input, mask, workspace.row); break;
+            default: _morphHorizontal<Op, MORPH_SPECIALISED_ITER>(*input, mask, workspace.row); break;
+        }
+        input = &mask;
+    }
+}
+
+/*
+ * Erodes a binary mask, same result as erode(mask, output, Mat(), Point(-1, -1), iterations).
+ *
+ * @param Mat mask, CV_8UC1 with 0 and 255
+ * @param Mat output, CV_8UC1 with 0 and 255, may be mask
+ * @param int iterations
+ * @author Dylan Van Assche
+ */
+void erodeMask(const Mat &mask, Mat &output, int iterations) {
+    MorphWorkspace &workspace = *morphWorkspaces.get();
+    packBitMask(mask, workspace.packed);
+    _morphPacked<ErodeOp>(workspace.packed, workspace, iterations);
+    unpackBitMask(workspace.packed, output);
+}
+
+/*
+ * Dilates a binary mask, same result as dilate(mask, output, Mat(), Point(-1, -1), iterations).
+ *
+ * @param Mat mask, CV_8UC1 with 0 and 255
+ * @param Mat output, CV_8UC1 with 0 and 255, may be mask
+ * @param int iterations
+ * @author Dylan Van Assche
+ */
+void dilateMask(const Mat &mask, Mat &output, int iterations) {
+    MorphWorkspace &workspace = *morphWorkspaces.get();
+    packBitMask(mask, workspace.packed);
+    _morphPacked<DilateOp>(workspace.packed, workspace, iterations);
+    unpackBitMask(workspace.packed, output);
+}
+
+/*
+ * Opening (erosion, then dilation) of a binary mask, same result as morphologyEx() with MORPH_OPEN and Mat() as kernel.
+ *
+ * @param Mat mask, CV_8UC1 with 0 and 255
+ * @param Mat output, CV_8UC1 with 0 and 255, may be mask
+ * @param int iterations
+ * @author Dylan Van Assche
+ */
+void openMask(const Mat &mask, Mat &output, int iterations) {
+    MorphWorkspace &workspace = *morphWorkspaces.get();
+    packBitMask(mask, workspace.packed);
+    _morphPacked<ErodeOp>(workspace.packed, workspace, iterations);
+    _morphPacked<DilateOp>(workspace.packed, workspace, iterations);
+    unpackBitMask(workspace.packed, output);
+}
+
+/*
+ * Closing (dilation, then erosion) of a binary mask, same result as morphologyEx() with MORPH_CLOSE and Mat() as
+ * kernel.
+ *
+ * @param Mat mask, CV_8UC1 with 0 and 255
+ * @param Mat output, CV_8UC1 with 0 and 255, may be mask
+ * @param int iterations
+ * @author Dylan Van Assche
+ */
+void closeMask(const Mat &mask, Mat &output, int iterations) {
+    MorphWorkspace &workspace = *morphWorkspaces.get();
+    packBitMask(mask, workspace.packed);
+    _morphPacked<DilateOp>(workspace.packed, workspace, iterations);
+    _morphPacked<ErodeOp>(workspace.packed, workspace, iterations);
+    unpackBitMask(workspace.packed, output);
+}
+
+/*
+ * Opening followed by closing of a binary mask, the usual noise removal and blob connection of the sessions. The mask
+ * is only packed and unpacked once.
+ *
+ * @param Mat mask, CV_8UC1 with 0 and 255
+ * @param Mat output, CV_8UC1 with 0 and 255, may be mask
+ * @param int openingIterations
+ * @param int closingIterations
+ * @author Dylan Van Assche
+ */
+void openCloseMask(const Mat &mask, Mat &output, int openingIterations, int closingIterations) {
+    MorphWorkspace &workspace = *morphWorkspaces.get();
+    packBitMask(mask, workspace.packed);
+    _morphPacked<ErodeOp>(workspace.packed, workspace, openingIterations);
+    _morphPacked<DilateOp>(workspace.packed, workspace, openingIterations);
+    _morphPacked<DilateOp>(workspace.packed, workspace, closingIterations);
+    _morphPacked<ErodeOp>(workspace.packed, workspace, closingIterations);
+    unpackBitMask(workspace.packed, output);
+}
+
+/*
+ * Erodes a BitMask in place, same result as erode() with Mat() as kernel on the unpacked mask.
+ *
+ * @param BitMask mask
+ * @param int iterations
+ * @author Dylan Van Assche
+ */
+void erodeBitMask(BitMask &mask, int iterations) {
+    _morphPacked<ErodeOp>(mask, *morphWorkspaces.get(), iterations);
+}
+
+/*
+ * Dilates a BitMask in place, same result as dilate() with Mat() as kernel on the unpacked mask.
+ *
+ * @param BitMask mask
+ * @param int iterations
+ * @author Dylan Van Assche
+ */
+void dilateBitMask(BitMask &mask, int iterations) {
+    _morphPacked<DilateOp>(mask, *morphWorkspaces.get(), iterations);
+}
@@ -0,0 +1,18 @@
+#ifndef MORPHOLOGY_H
+#define MORPHOLOGY_H
+
+#include <opencv2/opencv.hpp>
+#include "bitmask.h"
+
+// Binary morphology with the default 3x3 rectangle kernel
+#define MORPH_SPECIALISED_ITER 8 // largest horizontal pass with a compile-time specialised kernel, more iterations take several passes
+
+void erodeMask(const cv::Mat &mask, cv::Mat &output, int iterations);
+void dilateMask(const cv::Mat &mask, cv::Mat &output, int iterations);
+void openMask(const cv::Mat &mask, cv::Mat &output, int iterations);
+void closeMask(const cv::Mat &mask, cv::Mat &output, int iterations);
+void openCloseMask(const cv::Mat &mask, cv::Mat &output, int openingIterations, int closingIterations);
+void erodeBitMask(BitMask &mask, int iterations);
+void dilateBitMask(BitMask &mask, int iterations);
+
+#endif //MORPHOLOGY_H
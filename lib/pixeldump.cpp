@@ -0,0 +1,182 @@
+/*
+ * @title Labo beeldinterpretatie 2018: shared kernels
+ * @author Dylan Van Assche
+ *
+ * ---> BULK PIXEL EXPORT <---
+ *
+ * Printing every pixel with cout << (int)pixel << " " and endl flushes the stream after every row and formats every
+ * integer separately, a 12 MP image takes minutes. The exports below format or copy complete rows into a buffer and
+ * write large blocks at once:
+ *
+ *  - Text: the same "v v v \n" layout as the pixel loop of sessie 0, the text of the 256 possible values is
+ *    formatted once and copied for every pixel.
+ *  - PGM: binary greyscale image (P5), readable by every image viewer and by imread().
+ *  - NPY: NumPy array (version 1.0), numpy.load() gives a rows x cols (x channels) uint8 array.
+ *
+ */
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include "pixeldump.h"
+
+using namespace std;
+using namespace cv;
+
+#define NPY_MAGIC "\x93NUMPY"
+#define NPY_ALIGNMENT 64
+
+/*
+ * Writes the values of an 8 bit image as text: the values of a row separated by a space (channels interleaved), one
+ * row per line and an empty line at the end.
+ *
+ * @param ostream out
+ * @param Mat image, CV_8U with any number of channels
+ * @returns bool true on success
+ * @author Dylan Van Assche
+ */
+bool writePixelsText(ostream &out, const Mat &image) {
+    CV_Assert(image.depth() == CV_8U);
+
+    // "0 " ... "255 ", at most 4 characters each
+    char digits[256][4];
+    int lengths[256];
+    for(int v=0; v < 256; ++v) {
+        int length = 0;
+        if(v >= 100) {
+            digits[v][length++] = (char)('0' + v / 100);
+        }
+        if(v >= 10) {
+            digits[v][length++] = (char)('0' + v / 10 % 10);
+        }
+        digits[v][length++] = (char)('0' + v % 10);
+        digits[v][length++] = ' ';
+        lengths[v] = length;
+    }
+
+    int values = image.cols * image.channels();
+    vector<char> buffer(PIXEL_DUMP_TEXT_CHUNK + 4 * values + 2);
+    size_t used = 0;
+    for(int y=0; y < image.rows; ++y) {
+        const uchar *pixel = image.ptr<uchar>(y);
+        char *text = &buffer[used];
+        for(int x=0; x < values; ++x) {
+            memcpy(text, digits[pixel[x]], 4);
+            text += lengths[pixel[x]];
+        }
+        *text++ = '\n';
+        used = text - &buffer[0];
+
+        if(used >= PIXEL_DUMP_TEXT_CHUNK) {
+            out.write(&buffer[0], used);
+            used = 0;
+        }
+    }
+    buffer[used++] = '\n';
+    out.write(&buffer[0], used);
+    out.flush();
+
+    return out.good();
+}
+
+/*
+ * Saves the values of an 8 bit image as text, see writePixelsText().
+ *
+ * @param string path
+ * @param Mat image, CV_8U
+ * @returns bool true on success
+ * @author Dylan Van Assche
+ */
+bool savePixelsText(const string &path, const Mat &image) {
+    ofstream file(path.c_str(), ios::binary);
+    return file && writePixelsText(file, image);
+}
+
+/*
+ * Saves a greyscale image as binary PGM (P5).
+ *
+ * @param string path
+ * @param Mat grey, CV_8UC1
+ * @returns bool true on success
+ * @author Dylan Van Assche
+ */
+bool savePixelsPgm(const string &path, const Mat &grey) {
+    CV_Assert(grey.type() == CV_8UC1);
+    ofstream file(path.c_str(), ios::binary);
+    if(!file) {
+        return false;
+    }
+
+    file << "P5\n" << grey.cols << " " << grey.rows << "\n255\n";
+    if(grey.isContinuous()) {
+        file.write((const char *)grey.ptr<uchar>(0), grey.total());
+    }
+    else {
+        for(int y=0; y < grey.rows; ++y) {
+            file.write((const char *)grey.ptr<uchar>(y), grey.cols);
+        }
+    }
+
+    return file.good();
+}
+
+/*
+ * Saves an 8 bit image as NumPy array (NPY version 1.0): rows x cols for 1 channel, rows x cols x channels otherwise.
+ *
+ * @param string path
+ * @param Mat image, CV_8U
+ * @returns bool true on success
+ * @author Dylan Van Assche
+ */
+bool savePixelsNpy(const string &path, const Mat &image) {
+    CV_Assert(image.depth() == CV_8U);
+    ofstream file(path.c_str(), ios::binary);
+    if(!file) {
+        return false;
+    }
+
+    // Python dict literal, padded with spaces and ended by a newline so the data starts aligned
+    ostringstream dict;
+    dict << "{'descr': '|u1', 'fortran_order': False, 'shape': (" << image.rows << ", " << image.cols;
+    if(image.channels() > 1) {
+        dict << ", " << image.channels();
+    }
+    dict << "), }";
+    string header = dict.str();
+    size_t prefix = strlen(NPY_MAGIC) + 4; // magic, version, header length
+    header.append(NPY_ALIGNMENT - (prefix + header.size() + 1) % NPY_ALIGNMENT, ' ');
+    header += '\n';
+
+    unsigned short length = (unsigned short)header.size();
+    char version[4] = {1, 0, (char)(length & 0xFF), (char)(length >> 8)}; // little endian length
+    file.write(NPY_MAGIC, strlen(NPY_MAGIC));
+    file.write(version, sizeof(version));
+    file.write(header.data(), header.size());
+
+    size_t rowSize = image.cols * image.elemSize();
+    for(int y=0; y < image.rows; ++y) {
+        file.write((const char *)image.ptr<uchar>(y), rowSize);
+    }
+
+    return file.good();
+}
+
+/*
+ * Saves the pixels of an image in the format of the file extension: .pgm, .npy or text otherwise.
+ *
+ * @param string path
+ * @param Mat image, CV_8U
+ * @returns bool true on success
+ * @author Dylan Van Assche
+ */
+bool savePixels(const string &path, const Mat &image) {
+    size_t dot = path.rfind('.');
+    string extension = dot == string::npos ? "" : path.substr(dot);
+
+    if(extension == ".pgm") {
+        return savePixelsPgm(path, image);
+    }
+    else if(extension == ".npy") {
+        return savePixelsNpy(path, image);
+    }
+    return savePixelsText(path, image);
+}
@@ -0,0 +1,17 @@
+#ifndef PIXELDUMP_H
+#define PIXELDUMP_H
+
+#include <iostream>
+#include <string>
+#include <opencv2/opencv.hpp>
+
+// Bulk pixel export
+#define PIXEL_DUMP_TEXT_CHUNK (1 << 20) // bytes of text formatted before each write
+
+bool writePixelsText(std::ostream &out, const cv::Mat &image);
+bool savePixelsText(const std::string &path, const cv::Mat &image);
+bool savePixelsPgm(const std::string &path, const cv::Mat &grey);
+bool savePixelsNpy(const std::string &path, const cv::Mat &image);
+bool savePixels(const std::string &path, const cv::Mat &image);
+
+#endif //PIXELDUMP_H
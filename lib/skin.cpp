@@ -0,0 +1,75 @@
+/*
+ * @title Labo beeldinterpretatie 2018: shared kernels
+ * @author Dylan Van Assche
+ *
+ * ---> SKIN SEGMENTATION <---
+ *
+ * Fused kernel for the RGB skin rule of sessie 1:
+ *
+ *  (R > 95) && (G > 40) && (B > 20) && (max(R, G, B) - min(R, G, B) > 15) && (|R - G| > 15) && (R > G) && (R > B)
+ *
+ * Since R > G and R > B, max(R, G, B) = R and |R - G| = R - G. R - G > 15 implies R > G and
+ * R - min(G, B) >= R - G > 15, so the rule reduces to:
+ *
+ *  (R > 95) && (G > 40) && (B > 20) && (R - G > 15) && (R > B)
+ *
+ */
+#include <opencv2/core/hal/intrin.hpp>
+#include "skin.h"
+
+using namespace cv;
+
+/*
+ * The reduced skin rule for a single pixel, with the ColorRule signature of colorlut.h so it can be compiled into a LUT.
+ *
+ * @param uchar blue
+ * @param uchar green
+ * @param uchar red
+ * @param void* userData, unused
+ * @returns bool true for skin
+ * @author Dylan Van Assche
+ */
+bool skinRule(uchar blue, uchar green, uchar red, void *userData) {
+    return red > SKIN_MIN_RED && green > SKIN_MIN_GREEN && blue > SKIN_MIN_BLUE && red - green > SKIN_MIN_SPREAD && red > blue;
+}
+
+/*
+ * Computes the skin mask (255 = skin, 0 = no skin) of a BGR image in a single pass: each row is deinterleaved into
+ * its B, G, R channels in registers and the complete rule is evaluated 16 pixels at a time with the OpenCV universal
+ * intrinsics (SSE2, NEON, ...), without any temporary images. The remaining pixels of a row and builds without SIMD
+ * support use the scalar rule.
+ *
+ * @param Mat bgr, CV_8UC3
+ * @param Mat mask, CV_8UC1 output
+ * @author Dylan Van Assche
+ */
+void skinMask(const Mat &bgr, Mat &mask) {
+    CV_Assert(bgr.type() == CV_8UC3);
+    mask.create(bgr.size(), CV_8UC1);
+
+    for(int y=0; y < bgr.rows; ++y) {
+        const uchar *pixel = bgr.ptr<uchar>(y);
+        uchar *skin = mask.ptr<uchar>(y);
+        int x = 0;
+
+#if CV_SIMD128
+        v_uint8x16 minRed = v_setall_u8(SKIN_MIN_RED);
+        v_uint8x16 minGreen = v_setall_u8(SKIN_MIN_GREEN);
+        v_uint8x16 minBlue = v_setall_u8(SKIN_MIN_BLUE);
+        v_uint8x16 minSpread = v_setall_u8(SKIN_MIN_SPREAD);
+
+        for(; x <= bgr.cols - v_uint8x16::nlanes; x += v_uint8x16::nlanes) {
+            v_uint8x16 blue, green, red;
+            v_load_deinterleave(pixel + 3 * x, blue, green, red);
+
+            // Unsigned saturating subtraction: R - G is 0 when G >= R
+            v_uint8x16 result = (red > minRed) & (green > minGreen) & (blue > minBlue) & ((red - green) > minSpread) & (red > blue);
+            v_store(skin + x, result);
+        }
+#endif
+
+        for(; x < bgr.cols; ++x) {
+            skin[x] = skinRule(pixel[3 * x], pixel[3 * x + 1], pixel[3 * x + 2], NULL) ? 255 : 0;
+        }
+    }
+}
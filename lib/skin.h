@@ -0,0 +1,15 @@
+#ifndef SKIN_H
+#define SKIN_H
+
+#include <opencv2/opencv.hpp>
+
+// RGB skin rule from the literature (sessie 1)
+#define SKIN_MIN_RED 95
+#define SKIN_MIN_GREEN 40
+#define SKIN_MIN_BLUE 20
+#define SKIN_MIN_SPREAD 15 // max(R, G, B) - min(R, G, B) and |R - G|
+
+bool skinRule(uchar blue, uchar green, uchar red, void *userData);
+void skinMask(const cv::Mat &bgr, cv::Mat &mask);
+
+#endif //SKIN_H
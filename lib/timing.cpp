@@ -0,0 +1,58 @@
+/*
+ * @title Labo beeldinterpretatie 2018: shared kernels
+ * @author Dylan Van Assche
+ *
+ * ---> BENCHMARK HELPERS <---
+ *
+ * The benchmarks of the sessions time every implementation of a kernel on the same image and print one CSV row per
+ * implementation, with a column that tells if its result is identical to the first (reference) implementation.
+ *
+ */
+#include <iostream>
+#include "timing.h"
+
+using namespace std;
+using namespace cv;
+
+/*
+ * Milliseconds per call of an implementation, after a warm up call which allocates the output.
+ *
+ * @param BenchmarkImplementation implementation
+ * @param Mat input
+ * @param Mat output, result of the last call
+ * @param int iterations, number of measured calls
+ * @returns double ms per call
+ * @author Dylan Van Assche
+ */
+double timeImplementation(BenchmarkImplementation implementation, const Mat &input, Mat &output, int iterations) {
+    implementation(input, output);
+    int64 start = getTickCount();
+    for(int i = 0; i < iterations; i++) {
+        implementation(input, output);
+    }
+    return (getTickCount() - start) * 1000.0 / getTickFrequency() / iterations;
+}
+
+/*
+ * Prints the CSV header to stdout.
+ *
+ * @author Dylan Van Assche
+ */
+void printBenchmarkHeader() {
+    cout << BENCHMARK_CSV_HEADER << endl;
+}
+
+/*
+ * Prints the CSV row of an implementation to stdout.
+ *
+ * @param string name of the implementation
+ * @param Mat image, the benchmarked image (size and throughput)
+ * @param int iterations
+ * @param double ms per call
+ * @param bool same, result identical to the reference implementation
+ * @author Dylan Van Assche
+ */
+void printBenchmarkRow(const string &name, const Mat &image, int iterations, double ms, bool same) {
+    cout << name << "," << image.cols << "," << image.rows << "," << iterations << "," << ms << ","
+         << image.total() / 1e3 / ms << "," << (same ? "yes" : "no") << endl;
+}
@@ -0,0 +1,16 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <string>
+#include <opencv2/opencv.hpp>
+
+// CSV of the benchmarks, one row per implementation
+#define BENCHMARK_CSV_HEADER "implementation,width,height,iterations,ms_per_call,megapixels_per_second,identical"
+
+typedef void (*BenchmarkImplementation)(const cv::Mat &input, cv::Mat &output);
+
+double timeImplementation(BenchmarkImplementation implementation, const cv::Mat &input, cv::Mat &output, int iterations);
+void printBenchmarkHeader();
+void printBenchmarkRow(const std::string &name, const cv::Mat &image, int iterations, double ms, bool same);
+
+#endif //TIMING_H
@@ -0,0 +1,104 @@
+/*
+ * @title Labo beeldinterpretatie 2018: project
+ * @author Dylan Van Assche
+ *
+ * ---> BASIC MUSIC NOTES RECOGNITION: ALLOCATION COUNTER <---
+ *
+ * Counts the heap allocations of the process to measure the allocations per call of each pipeline stage:
+ *  - heap allocations: every call of the global operator new, including the ones of OpenCV and the STL containers.
+ *  - Mat allocations: every buffer allocated for a Mat by the default OpenCV allocator.
+ *
+ * The counters are updated atomically since the pipeline allocates from multiple threads. This file replaces the
+ * global operator new, only link it in the benchmark and regression executables.
+ *
+ */
+#include <new>
+#include "notes.h"
+
+static int heapAllocations = 0;
+static int matAllocations = 0;
+
+/*
+ * Mat allocator which counts the allocated buffers and lets the standard OpenCV allocator do the actual work.
+ * Deallocation happens directly by the standard allocator since it owns the allocated buffers.
+ *
+ * @author Dylan Van Assche
+ */
+class CountingMatAllocator : public MatAllocator {
+public:
+    UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step, int flags, UMatUsageFlags usageFlags) const {
+        if(!data) {
+            CV_XADD(&matAllocations, 1);
+        }
+        return Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usageFlags);
+    }
+
+    bool allocate(UMatData* data, int accessFlags, UMatUsageFlags usageFlags) const {
+        return Mat::getStdAllocator()->allocate(data, accessFlags, usageFlags);
+    }
+
+    void deallocate(UMatData* data) const {
+        Mat::getStdAllocator()->deallocate(data);
+    }
+};
+
+void* operator new(size_t size) throw(std::bad_alloc) {
+    CV_XADD(&heapAllocations, 1);
+    void *p = malloc(size ? size : 1);
+    if(!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new[](size_t size) throw(std::bad_alloc) {
+    return operator new(size);
+}
+
+void operator delete(void *p) throw() {
+    free(p);
+}
+
+void operator delete[](void *p) throw() {
+    free(p);
+}
+
+/*
+ * Installs the counting allocator as default allocator for all Mat objects.
+ *
+ * @author Dylan Van Assche
+ */
+void installAllocationCounter() {
+    static CountingMatAllocator allocator;
+    Mat::setDefaultAllocator(&allocator);
+}
+
+/*
+ * Resets both counters to zero, call it when no other threads are allocating.
+ *
+ * @author Dylan Van Assche
+ */
+void resetAllocationCounters() {
+    heapAllocations = 0;
+    matAllocations = 0;
+}
+
+/*
+ * Number of operator new calls since the last reset.
+ *
+ * @returns int count
+ * @author Dylan Van Assche
+ */
+int heapAllocationCount() {
+    return CV_XADD(&heapAllocations, 0);
+}
+
+/*
+ * Number of Mat buffers allocated since the last reset.
+ *
+ * @returns int count
+ * @author Dylan Van Assche
+ */
+int matAllocationCount() {
+    return CV_XADD(&matAllocations, 0);
+}
@@ -0,0 +1,618 @@
+/*
+ * @title Labo beeldinterpretatie 2018: project
+ * @author Dylan Van Assche
+ *
+ * ---> BASIC MUSIC NOTES RECOGNITION: BENCHMARK <---
+ *
+ * Measures the performance of every stage of the music notes recognition pipeline in isolation on synthetic sheets of
+ * increasing size (see renderSheet()). The results are written as CSV to stdout, one line per measurement in a fixed
+ * order, so they can be compared between commits. The sheets are generated with a fixed seed.
+ *
+ * Measurements:
+ *  - preprocess_reference: the original opening + inversion + adaptive threshold chain, a full pass for each step.
+ *  - preprocess_fused_<binarization>: the cache-blocked preprocessing kernel of splitStaffLinesAndNotes().
+ *  - binarize_<binarization>_<block size>: only the binarization step for growing block sizes.
+ *  - splitStaffLinesAndNotes, getContoursData, getContoursDataFromBank_<templates>, getStaffLineDistances,
+ *    convertDataToNote: throughput in megapixels of the sheet per second.
+ *  - generateWaveform, saveWaveforms, renderTimeline: throughput in audio samples per second.
+ *  - buildTimeline: throughput in megapixels of the sheet per second (bar lines search).
+ *  - createRecognitionCache, updateRecognition_one_measure: complete recognition against the incremental update after
+ *    a smudge in one measure (see updateRecognition()), throughput in megapixels of the sheet per second.
+ *
+ * Columns:
+ *  - allocations_per_call: heap allocations (operator new) per call, including the ones inside OpenCV.
+ *  - mat_allocations_per_call: Mat buffers allocated per call.
+ *  - workspace_allocations_per_call: buffers added to the workspaces per call, 0 in the steady state (see workspace.cpp).
+ *  - estimated_traffic_mb: memory traffic estimated from the number of full image passes of the preprocessing, not a
+ *    hardware counter measurement.
+ *  - agreement_percent: percentage of pixels equal to the Gaussian adaptive threshold, or of notes equal to the
+ *    complete recognition for the incremental update.
+ *
+ * Plotting the throughput against the number of pixels of each DPI gives the scaling curve of each stage.
+ *
+ * Usage:
+ *  - cmake CMakeLists.txt
+ *  - make
+ *  - ./benchmark --dpis=75,150,300 --iterations=5
+ *  - Optional: --sheet=test.png adds a real sheet to the preprocessing and binarization measurements.
+ *
+ */
+#include "notes.h"
+
+// Full image passes (read + write) of the reference chain: clone, erode, dilate, invert, Gaussian mean, compare
+#define REFERENCE_PASSES (2 + 2 + 2 + 2 + 2 + 3)
+#define BENCHMARK_SEED 2018
+
+// Binarization block sizes for the scaling measurements
+const int BLOCK_SIZES[] = {THRESHOLD_BLOCK_SIZE, 2 * THRESHOLD_BLOCK_SIZE + 1, 4 * THRESHOLD_BLOCK_SIZE + 1};
+const int NUMBER_OF_BLOCK_SIZES = sizeof(BLOCK_SIZES) / sizeof(BLOCK_SIZES[0]);
+const char *BINARIZATION_NAMES[] = {"gaussian", "mean", "sauvola"}; // Same order as Binarization
+const int NUMBER_OF_BINARIZATIONS = sizeof(BINARIZATION_NAMES) / sizeof(BINARIZATION_NAMES[0]);
+
+typedef struct Measurement {
+    int iterations;
+    double seconds; // per call
+    double allocations; // per call
+    double matAllocations; // per call
+    double workspaceAllocations; // per call
+} Measurement;
+
+/*
+ * A stage of the pipeline with its inputs, run() executes it once. The output is kept in the stage so the next stage
+ * can use it as input.
+ *
+ * @author Dylan Van Assche
+ */
+class BenchmarkStage {
+public:
+    virtual ~BenchmarkStage() {}
+    virtual void run() = 0;
+};
+
+class PreprocessStage : public BenchmarkStage {
+public:
+    Mat input;
+    int binarization; // -1 for the reference chain
+    Mat output;
+
+    void run() {
+        if(binarization < 0) {
+            preprocessSheetReference(input, output);
+        }
+        else {
+            preprocessSheet(input, output, (Binarization) binarization);
+        }
+    }
+};
+
+class BinarizeStage : public BenchmarkStage {
+public:
+    Mat inverted;
+    Binarization method;
+    int blockSize;
+    Mat output;
+
+    void run() {
+        binarizeSheet(inverted, output, method, blockSize);
+    }
+};
+
+class SplitStage : public BenchmarkStage {
+public:
+    Mat sheet;
+    NoteSheet output;
+
+    void run() {
+        output = NoteSheet(); // Results of the previous sheet are released like in a batch
+        output = splitStaffLinesAndNotes(sheet);
+    }
+};
+
+class ContoursStage : public BenchmarkStage {
+public:
+    Mat notes;
+    NoteTemplate templ;
+    ContoursData output;
+
+    void run() {
+        output = ContoursData(); // Results of the previous sheet are released like in a batch
+        output = getContoursData(notes, templ);
+    }
+};
+
+class ContoursBankStage : public BenchmarkStage {
+public:
+    Mat notes;
+    vector<NoteTemplate> bank;
+    ContoursData output;
+
+    void run() {
+        output = ContoursData(); // Results of the previous sheet are released like in a batch
+        output = getContoursDataFromBank(notes, bank);
+    }
+};
+
+class StaffLinesStage : public BenchmarkStage {
+public:
+    Mat staffLines;
+    vector<StaffLineData> output;
+
+    void run() {
+        output = getStaffLineDistances(staffLines);
+    }
+};
+
+class ConvertStage : public BenchmarkStage {
+public:
+    Mat notes;
+    vector<ContoursData> data;
+    vector<StaffLineData> distances;
+    vector<Note> output;
+
+    void run() {
+        output = convertDataToNote(notes, data, distances, notes.rows, notes.cols);
+    }
+};
+
+class WaveformStage : public BenchmarkStage {
+public:
+    vector<Note> notes;
+    vector< vector<short> > output;
+
+    void run() {
+        output.clear();
+        for(int n=0; n < notes.size(); ++n) {
+            output.push_back(generateWaveform(notes.at(n).frequency, notes.at(n).length));
+        }
+    }
+};
+
+class TimelineStage : public BenchmarkStage {
+public:
+    Mat notesImage;
+    vector<Note> notes;
+    vector<StaffLineData> distances;
+    Timeline output;
+
+    void run() {
+        output = buildTimeline(notesImage, notes, distances);
+    }
+};
+
+class RenderStage : public BenchmarkStage {
+public:
+    Timeline timeline;
+    vector<short> output;
+
+    void run() {
+        output = renderTimeline(timeline);
+    }
+};
+
+class SaveStage : public BenchmarkStage {
+public:
+    string path;
+    vector< vector<short> > waveforms;
+
+    void run() {
+        saveWaveforms(path, waveforms);
+    }
+};
+
+class RecognitionCacheStage : public BenchmarkStage {
+public:
+    Mat sheet;
+    NoteTemplate doubleEighthTempl;
+    NoteTemplate quarterTempl;
+    RecognitionCache output;
+
+    void run() {
+        output = RecognitionCache(); // Results of the previous sheet are released like in a batch
+        output = createRecognitionCache(sheet, doubleEighthTempl, quarterTempl);
+    }
+};
+
+class IncrementalStage : public BenchmarkStage {
+public:
+    RecognitionCache cache;
+    Mat versions[2];
+    int current;
+
+    void run() {
+        // Every call switches to the other version of the sheet
+        current = 1 - current;
+        updateRecognition(cache, versions[current]);
+    }
+};
+
+/*
+ * Runs a stage once to warm up caches and the thread pool, then measures the time and allocations of a number of
+ * iterations.
+ *
+ * @param BenchmarkStage stage
+ * @param int iterations
+ * @returns Measurement measurement
+ * @author Dylan Van Assche
+ */
+Measurement measure(BenchmarkStage &stage, int iterations) {
+    Measurement measurement;
+    stage.run();
+
+    resetAllocationCounters();
+    resetWorkspaceAllocationCount();
+    int64 start = getTickCount();
+    for(int i=0; i < iterations; ++i) {
+        stage.run();
+    }
+    measurement.seconds = (getTickCount() - start) / getTickFrequency() / iterations;
+    measurement.allocations = (double) heapAllocationCount() / iterations;
+    measurement.matAllocations = (double) matAllocationCount() / iterations;
+    measurement.workspaceAllocations = (double) workspaceAllocationCount() / iterations;
+    measurement.iterations = iterations;
+
+    return measurement;
+}
+
+/*
+ * Percentage of pixels which are equal in both binary images.
+ *
+ * @param Mat a
+ * @param Mat b
+ * @returns double agreement
+ * @author Dylan Van Assche
+ */
+double agreement(Mat a, Mat b) {
+    Mat difference;
+    absdiff(a, b, difference);
+    return 100.0 * (1.0 - (double) countNonZero(difference) / difference.total());
+}
+
+/*
+ * Percentage of notes which are equal in both lists, sorted by position.
+ *
+ * @param vector<Note> a
+ * @param vector<Note> b
+ * @returns double agreement
+ * @author Dylan Van Assche
+ */
+double notesAgreement(vector<Note> a, vector<Note> b) {
+    int equal = 0;
+    int total = max(a.size(), b.size());
+
+    for(int n=0; n < min(a.size(), b.size()); ++n) {
+        if(a.at(n).position == b.at(n).position && a.at(n).frequency == b.at(n).frequency && a.at(n).length == b.at(n).length) {
+            ++equal;
+        }
+    }
+
+    return total == 0 ? 100.0 : 100.0 * equal / total;
+}
+
+/*
+ * Prints a CSV line with the results of a measurement. Unknown values (traffic or agreement < 0) are left empty.
+ *
+ * @param string name
+ * @param string input
+ * @param Size size
+ * @param Measurement measurement
+ * @param double amount processed per call (pixels or samples)
+ * @param string unit of the throughput
+ * @param double bytesPerCall
+ * @param double agreementPercentage
+ * @author Dylan Van Assche
+ */
+void printResult(string name, string input, Size size, Measurement measurement, double amount, string unit,
+                 double bytesPerCall, double agreementPercentage) {
+    cout << name << ","
+         << input << ","
+         << size.width << ","
+         << size.height << ","
+         << measurement.iterations << ","
+         << measurement.seconds * 1000.0 << ","
+         << amount / 1e6 / measurement.seconds << ","
+         << unit << ","
+         << measurement.allocations << ","
+         << measurement.matAllocations << ","
+         << measurement.workspaceAllocations << ",";
+    if(bytesPerCall >= 0) {
+        cout << bytesPerCall / 1e6;
+    }
+    cout << ",";
+    if(agreementPercentage >= 0) {
+        cout << agreementPercentage;
+    }
+    cout << endl;
+}
+
+/*
+ * Measures the reference preprocessing chain against the fused kernel with each binarization and the binarization
+ * step alone for growing block sizes.
+ *
+ * The integral image binarizations take all their buffers from the workspace: in the steady state they may not allocate
+ * any heap memory, Mat buffer or workspace buffer.
+ *
+ * @param string name of the input
+ * @param Mat sheet
+ * @param int iterations
+ * @param bool allocationFree, set to false if an integral image binarization allocates in the steady state
+ * @returns bool true if the fused Gaussian kernel gives the same result as the reference chain
+ * @author Dylan Van Assche
+ */
+bool benchmarkPreprocessing(string name, Mat sheet, int iterations, bool &allocationFree) {
+    // Memory traffic estimation: every tile is read together with its halo, written back without it
+    double pageBytes = (double) sheet.total() * sheet.elemSize();
+    double tileBytes = (double) (PREPROCESS_TILE_SIZE + 2 * PREPROCESS_HALO) * (PREPROCESS_TILE_SIZE + 2 * PREPROCESS_HALO);
+    double haloOverhead = tileBytes / (PREPROCESS_TILE_SIZE * PREPROCESS_TILE_SIZE);
+    bool identical = true;
+
+    PreprocessStage reference;
+    reference.input = sheet;
+    reference.binarization = -1;
+    Measurement m = measure(reference, iterations);
+    printResult("preprocess_reference", name, sheet.size(), m, sheet.total(), "megapixels_per_second",
+                REFERENCE_PASSES * pageBytes, 100.0);
+
+    for(int b=0; b < NUMBER_OF_BINARIZATIONS; ++b) {
+        PreprocessStage fused;
+        fused.input = sheet;
+        fused.binarization = b;
+        m = measure(fused, iterations);
+        double agreementPercentage = agreement(reference.output, fused.output);
+        printResult(string("preprocess_fused_") + BINARIZATION_NAMES[b], name, sheet.size(), m, sheet.total(),
+                    "megapixels_per_second", (haloOverhead + 1) * pageBytes, agreementPercentage);
+
+        // The fused Gaussian kernel must give exactly the same binary image as the reference
+        if(b == BINARIZE_GAUSSIAN && agreementPercentage < 100.0) {
+            identical = false;
+        }
+    }
+
+    // Binarization only: cost for growing block sizes, agreement with the Gaussian threshold of the same block size
+    Mat inverted = ~sheet;
+    for(int s=0; s < NUMBER_OF_BLOCK_SIZES; ++s) {
+        Mat gaussian;
+        for(int b=0; b < NUMBER_OF_BINARIZATIONS; ++b) {
+            BinarizeStage binarize;
+            binarize.inverted = inverted;
+            binarize.method = (Binarization) b;
+            binarize.blockSize = BLOCK_SIZES[s];
+            m = measure(binarize, iterations);
+            if(b == BINARIZE_GAUSSIAN) {
+                gaussian = binarize.output;
+            }
+
+            stringstream stageName;
+            stageName << "binarize_" << BINARIZATION_NAMES[b] << "_" << BLOCK_SIZES[s];
+            printResult(stageName.str(), name, inverted.size(), m, inverted.total(), "megapixels_per_second", -1,
+                        agreement(gaussian, binarize.output));
+
+            // adaptiveThreshold() allocates its mean image, the integral image methods reuse the workspace
+            if(b != BINARIZE_GAUSSIAN && (m.allocations > 0 || m.matAllocations > 0 || m.workspaceAllocations > 0)) {
+                cerr << stageName.str() << ": allocations in the steady state" << endl;
+                allocationFree = false;
+            }
+        }
+    }
+
+    return identical;
+}
+
+/*
+ * Measures every stage of the pipeline in isolation, each stage uses the output of the previous one as input.
+ *
+ * @param string name of the input
+ * @param Mat sheet
+ * @param NoteTemplate doubleEighthTempl, inverted like in main.cpp
+ * @param NoteTemplate quarterTempl, inverted like in main.cpp
+ * @param int iterations
+ * @param string wavPath
+ * @author Dylan Van Assche
+ */
+void benchmarkPipeline(string name, Mat sheet, NoteTemplate doubleEighthTempl, NoteTemplate quarterTempl, int iterations, string wavPath) {
+    SplitStage split;
+    split.sheet = sheet;
+    Measurement m = measure(split, iterations);
+    printResult("splitStaffLinesAndNotes", name, sheet.size(), m, sheet.total(), "megapixels_per_second", -1, -1);
+
+    // Double eighth notes first, quarter notes are found on the image without them (see main.cpp)
+    ContoursStage contoursDoubleEighth;
+    contoursDoubleEighth.notes = split.output.notes;
+    contoursDoubleEighth.templ = doubleEighthTempl;
+    m = measure(contoursDoubleEighth, iterations);
+    printResult("getContoursData", name, sheet.size(), m, sheet.total(), "megapixels_per_second", -1, -1);
+
+    // Same templates with their flipped and rotated variants
+    ContoursBankStage contoursBank;
+    contoursBank.notes = split.output.notes;
+    contoursBank.bank = createTemplateBank(doubleEighthTempl);
+    m = measure(contoursBank, iterations);
+    stringstream bankName;
+    bankName << "getContoursDataFromBank_" << contoursBank.bank.size();
+    printResult(bankName.str(), name, sheet.size(), m, sheet.total(), "megapixels_per_second", -1, -1);
+
+    ContoursStage contoursQuarter;
+    contoursQuarter.notes = contoursDoubleEighth.output.image;
+    contoursQuarter.templ = quarterTempl;
+    contoursQuarter.run();
+
+    StaffLinesStage staffLines;
+    staffLines.staffLines = split.output.staffLines;
+    m = measure(staffLines, iterations);
+    printResult("getStaffLineDistances", name, sheet.size(), m, sheet.total(), "megapixels_per_second", -1, -1);
+
+    ConvertStage convert;
+    convert.notes = split.output.notes;
+    convert.data.push_back(contoursDoubleEighth.output);
+    convert.data.push_back(contoursQuarter.output);
+    convert.distances = staffLines.output;
+    m = measure(convert, iterations);
+    printResult("convertDataToNote", name, sheet.size(), m, sheet.total(), "megapixels_per_second", -1, -1);
+
+    WaveformStage waveforms;
+    waveforms.notes = convert.output;
+    m = measure(waveforms, iterations);
+    double samples = 0;
+    for(int n=0; n < convert.output.size(); ++n) {
+        samples += (int) convert.output.at(n).length;
+    }
+    printResult("generateWaveform", name, sheet.size(), m, samples, "megasamples_per_second", -1, -1);
+
+    SaveStage save;
+    save.path = wavPath;
+    save.waveforms = waveforms.output;
+    m = measure(save, iterations);
+    printResult("saveWaveforms", name, sheet.size(), m, samples, "megasamples_per_second", -1, -1);
+
+    TimelineStage timeline;
+    timeline.notesImage = split.output.notes;
+    timeline.notes = convert.output;
+    timeline.distances = staffLines.output;
+    m = measure(timeline, iterations);
+    printResult("buildTimeline", name, sheet.size(), m, sheet.total(), "megapixels_per_second", -1, -1);
+
+    RenderStage render;
+    render.timeline = timeline.output;
+    m = measure(render, iterations);
+    printResult("renderTimeline", name, sheet.size(), m, timeline.output.length, "megasamples_per_second", -1, -1);
+}
+
+/*
+ * Measures the complete recognition of a sheet with createRecognitionCache() against updateRecognition() after a one
+ * measure edit: a smudge next to a note is added and removed again. The agreement compares the notes of the incremental
+ * update with the complete recognition of the same version.
+ *
+ * @param string name of the input
+ * @param Mat sheet
+ * @param Rect note, bounding box of a note on the sheet
+ * @param int staffSpace in pixels
+ * @param NoteTemplate doubleEighthTempl, inverted like in main.cpp
+ * @param NoteTemplate quarterTempl, inverted like in main.cpp
+ * @param int iterations
+ * @author Dylan Van Assche
+ */
+void benchmarkIncremental(string name, Mat sheet, Rect note, int staffSpace, NoteTemplate doubleEighthTempl, NoteTemplate quarterTempl, int iterations) {
+    RecognitionCacheStage complete;
+    complete.sheet = sheet;
+    complete.doubleEighthTempl = doubleEighthTempl;
+    complete.quarterTempl = quarterTempl;
+    Measurement m = measure(complete, iterations);
+    printResult("createRecognitionCache", name, sheet.size(), m, sheet.total(), "megapixels_per_second", -1, -1);
+
+    IncrementalStage incremental;
+    incremental.cache = complete.output;
+    incremental.versions[0] = sheet;
+    incremental.versions[1] = sheet.clone();
+    incremental.current = 0;
+    circle(incremental.versions[1], Point(note.x + note.width + staffSpace, note.y + note.height / 2), staffSpace / 2,
+           Scalar::all(0), CIRCLE_THICKNESS);
+    m = measure(incremental, iterations);
+
+    complete.sheet = incremental.versions[incremental.current];
+    complete.run();
+    printResult("updateRecognition_one_measure", name, sheet.size(), m, sheet.total(), "megapixels_per_second", -1,
+                notesAgreement(incremental.cache.notes, complete.output.notes));
+}
+
+int main(int argc, const char** argv) {
+    CommandLineParser parser(argc, argv,
+                 "{ help h usage ?     |               | Shows this message.                                   }"
+                 "{ dpis               | 75,150,300    | Resolutions of the synthetic A4 sheets                }"
+                 "{ iterations i       | 5             | Number of measured calls per benchmark                }"
+                 "{ sheet s            |               | Optional real sheet for the preprocessing benchmarks  }"
+                 "{ wav                | benchmark.wav | Output path of the saveWaveforms benchmark            }"
+    );
+
+    // Help printing
+    if(parser.has("help")) {
+        parser.printMessage();
+        return 0;
+    }
+
+    // Parser fail
+    if (!parser.check()) {
+        parser.printErrors();
+        return -1;
+    }
+
+    // Required arguments supplied?
+    int iterations = parser.get<int>("iterations");
+    string sheet(parser.get<string>("sheet"));
+    string wavPath(parser.get<string>("wav"));
+    vector<int> dpis;
+    stringstream dpiList(parser.get<string>("dpis"));
+    string dpi;
+    while(getline(dpiList, dpi, ',')) {
+        dpis.push_back(atoi(dpi.c_str()));
+        if(dpis.back() <= 0) {
+            dpis.clear();
+            break;
+        }
+    }
+
+    if(iterations <= 0 || dpis.empty() || wavPath.empty()) {
+        cerr << "Please supply your parameters using command line arguments: "
+        << "--dpis=75,150,300 "
+        << "--iterations=5 "
+        << "--wav=benchmark.wav"
+        << endl;
+        return -2;
+    }
+
+    // Headless and counting allocations
+    displayResults = false;
+    installAllocationCounter();
+    bool identical = true;
+    bool allocationFree = true;
+
+    cout << "benchmark,input,width,height,iterations,ms_per_call,throughput,throughput_unit,allocations_per_call,"
+         << "mat_allocations_per_call,workspace_allocations_per_call,estimated_traffic_mb,agreement_percent" << endl;
+
+    // Real sheet: preprocessing only, the templates of the pipeline don't match its resolution
+    if(!sheet.empty()) {
+        Mat sheetImg = imread(sheet, IMREAD_GRAYSCALE);
+        if(sheetImg.empty()) {
+            cerr << "Loading images failed, please verify the paths to the images." << endl;
+            return -3;
+        }
+        identical &= benchmarkPreprocessing(sheet, sheetImg, iterations, allocationFree);
+    }
+
+    // Synthetic sheets of increasing size with their own templates
+    for(int d=0; d < dpis.size(); ++d) {
+        SheetConfig config = defaultSheetConfig();
+        config.dpi = dpis.at(d);
+        RNG rng(BENCHMARK_SEED);
+        vector<GroundTruthNote> truth;
+        Mat sheetImg = renderSheet(config, rng, truth);
+
+        // Associate the length of the note with each template, inverted like the notes image
+        NoteTemplate doubleEighthTempl;
+        doubleEighthTempl.templ = ~renderNoteTemplate(config, GLYPH_DOUBLE_EIGHTH);
+        doubleEighthTempl.length = NOTE_LENGTH_16;
+        NoteTemplate quarterTempl;
+        quarterTempl.templ = ~renderNoteTemplate(config, GLYPH_QUARTER);
+        quarterTempl.length = NOTE_LENGTH_4;
+
+        stringstream name;
+        name << "synthetic_" << config.dpi << "dpi";
+        identical &= benchmarkPreprocessing(name.str(), sheetImg, iterations, allocationFree);
+        benchmarkPipeline(name.str(), sheetImg, doubleEighthTempl, quarterTempl, iterations, wavPath);
+        if(!truth.empty()) {
+            int staffSpace = cvRound(STAFF_SPACE_MM * config.dpi / 25.4);
+            benchmarkIncremental(name.str(), sheetImg, truth.at(truth.size() / 2).box, staffSpace, doubleEighthTempl,
+                                 quarterTempl, iterations);
+        }
+    }
+
+    if(!identical) {
+        cerr << "Fused preprocessing differs from the reference!" << endl;
+        return -4;
+    }
+
+    if(!allocationFree) {
+        cerr << "Integral image binarization allocates in the steady state!" << endl;
+        return -4;
+    }
+
+    return 0;
+}
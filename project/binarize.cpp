@@ -0,0 +1,122 @@
+/*
+ * @title Labo beeldinterpretatie 2018: project
+ * @author Dylan Van Assche
+ *
+ * ---> BASIC MUSIC NOTES RECOGNITION <---
+ *
+ * This Proof-Of-Concept (POC) can extract the music notes from a music sheet and save the sound of them into a
+ * WAV audio file.
+ *
+ * Features:
+ *  - Detect non-rotated 1/4 and 1/16 notes using template matching.
+ *  - Find the tone height of each note using the staff lines extraction and vertical histograms.
+ *  - Merge both into a music tone and save it to a WAV audio file using a WAV library.
+ *
+ * Usage:
+ *  - cmake CMakeLists.txt
+ *  - make
+ *  - ./project --sheet=musicSheet.png --output=output.wav --quarter-note=quarter-note.png \
+ *    --double-eighth-note=double-eighth-note.png
+ *
+ */
+#include "notes.h"
+
+/*
+ * Converts the name of a binarization method to a Binarization value.
+ *
+ * @param string name
+ * @returns int binarization, -1 if the name is unknown
+ * @author Dylan Van Assche
+ */
+int binarizationFromName(string name) {
+    if(name == "gaussian") {
+        return BINARIZE_GAUSSIAN;
+    }
+    else if(name == "mean") {
+        return BINARIZE_MEAN;
+    }
+    else if(name == "sauvola") {
+        return BINARIZE_SAUVOLA;
+    }
+    return -1;
+}
+
+/*
+ * Adaptive threshold using integral images: the sum and the squared sum of every window are found with 4 lookups,
+ * the cost per pixel doesn't depend on the block size like the separable Gaussian of ADAPTIVE_THRESH_GAUSSIAN_C.
+ * Windows are clipped at the image borders.
+ *
+ * BINARIZE_MEAN: foreground when the pixel is brighter than the window mean - THRESHOLD_C (same rule as
+ * ADAPTIVE_THRESH_MEAN_C).
+ *
+ * BINARIZE_SAUVOLA: J. Sauvola and M. Pietikainen, "Adaptive document image binarization", the threshold follows the
+ * local contrast: T = mean * (1 + k * (stddev / R - 1)). The formula expects dark ink on a bright page, so it's applied
+ * on the non-inverted values.
+ *
+ * The integral images come from the workspace of the calling thread, the steady state doesn't allocate.
+ *
+ * @param Mat inverted
+ * @param Mat binary
+ * @param Binarization method
+ * @param int blockSize
+ * @author Dylan Van Assche
+ */
+void binarizeIntegral(Mat inverted, Mat &binary, Binarization method, int blockSize) {
+    int radius = blockSize / 2;
+
+    // Integral images have an extra row and column of zeros, reused for every tile of the same size
+    Mat sum = acquireWorkspaceBuffer(Size(inverted.cols + 1, inverted.rows + 1), CV_64FC1);
+    Mat squaredSum = acquireWorkspaceBuffer(Size(inverted.cols + 1, inverted.rows + 1), CV_64FC1);
+
+    // Input, sum, squared sum, depth of both (double: no overflow on high DPI sheets)
+    integral(inverted, sum, squaredSum, CV_64F, CV_64F);
+    binary.create(inverted.size(), CV_8UC1);
+
+    for(int y=0; y < inverted.rows; ++y) {
+        int y1 = max(0, y - radius);
+        int y2 = min(inverted.rows, y + radius + 1);
+        const double *sumTop = sum.ptr<double>(y1);
+        const double *sumBottom = sum.ptr<double>(y2);
+        const double *squaredSumTop = squaredSum.ptr<double>(y1);
+        const double *squaredSumBottom = squaredSum.ptr<double>(y2);
+        const uchar *source = inverted.ptr<uchar>(y);
+        uchar *destination = binary.ptr<uchar>(y);
+
+        for(int x=0; x < inverted.cols; ++x) {
+            int x1 = max(0, x - radius);
+            int x2 = min(inverted.cols, x + radius + 1);
+            double area = (double) (x2 - x1) * (y2 - y1);
+            double mean = (sumBottom[x2] - sumBottom[x1] - sumTop[x2] + sumTop[x1]) / area;
+
+            if(method == BINARIZE_MEAN) {
+                destination[x] = source[x] > mean - THRESHOLD_C ? THRESHOLD_MAX : 0;
+            }
+            else {
+                double squaredMean = (squaredSumBottom[x2] - squaredSumBottom[x1] - squaredSumTop[x2] + squaredSumTop[x1]) / area;
+                double deviation = sqrt(max(0.0, squaredMean - mean * mean));
+                double threshold = (255.0 - mean) * (1.0 + SAUVOLA_K * (deviation / SAUVOLA_R - 1.0));
+                destination[x] = (255 - source[x]) <= threshold ? THRESHOLD_MAX : 0;
+            }
+        }
+    }
+}
+
+/*
+ * Thresholds an inverted gray image (white notes on a black background) to a binary image with the selected method.
+ * The input and output must be different images.
+ *
+ * @param Mat inverted
+ * @param Mat binary
+ * @param Binarization method
+ * @param int blockSize
+ * @author Dylan Van Assche
+ */
+void binarizeSheet(Mat inverted, Mat &binary, Binarization method, int blockSize) {
+    if(method == BINARIZE_GAUSSIAN) {
+        // Input, output, maximum threshold value, mode, threshold type, block size, constant for subtraction
+        adaptiveThreshold(inverted, binary, THRESHOLD_MAX, ADAPTIVE_THRESH_GAUSSIAN_C, THRESH_BINARY, blockSize, THRESHOLD_C);
+    }
+    else {
+        binarizeIntegral(inverted, binary, method, blockSize);
+    }
+}
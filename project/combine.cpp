@@ -81,12 +81,12 @@ double _convertIndexToNoteFrequency(int index) {
  * @author Dylan Van Assche
  */
 vector<Note> convertDataToNote(Mat input, vector<ContoursData> data, vector<StaffLineData> staffLineDistances, int rows, int cols) {
-    Mat drawing = Mat::zeros(rows, cols, CV_8UC3);
-    input.copyTo(drawing);
-    Mat img = input.clone();
+    Mat drawing;
 
     // input image, output image, color space conversion code
-    cvtColor(drawing, drawing, CV_GRAY2BGR);
+    if(displayResults) {
+        cvtColor(input, drawing, CV_GRAY2BGR);
+    }
     double frequency = NOTE_A; // fallback in case detection fails
     double length = NOTE_LENGTH; // fallback in case detection fails
     Point noteLocation;
@@ -142,7 +142,9 @@ vector<Note> convertDataToNote(Mat input, vector<ContoursData> data, vector<Staf
     );
 
     // image to draw on, Rect object, color
-    rectangle(drawing, areaBefore, colorRed);
+    if(displayResults) {
+        rectangle(drawing, areaBefore, colorRed);
+    }
     areas.push_back(areaBefore);
 
     // Generate target areas on and between the staff lines
@@ -163,7 +165,9 @@ vector<Note> convertDataToNote(Mat input, vector<ContoursData> data, vector<Staf
             );
 
             // image to draw on, Rect object, color
-            rectangle(drawing, areaBetween, colorRed);
+            if(displayResults) {
+                rectangle(drawing, areaBetween, colorRed);
+            }
             areas.push_back(areaBetween);
         }
 
@@ -177,7 +181,9 @@ vector<Note> convertDataToNote(Mat input, vector<ContoursData> data, vector<Staf
         );
 
         // image to draw on, Rect object, color
-        rectangle(drawing, areaOn, colorGreen);
+        if(displayResults) {
+            rectangle(drawing, areaOn, colorGreen);
+        }
         areas.push_back(areaOn);
     }
 
@@ -191,24 +197,32 @@ vector<Note> convertDataToNote(Mat input, vector<ContoursData> data, vector<Staf
     );
 
     // image to draw on, Rect object, color
-    rectangle(drawing, areaAfter, colorRed);
+    if(displayResults) {
+        rectangle(drawing, areaAfter, colorRed);
+    }
     areas.push_back(areaAfter);
 
     // Find for every note the frequency by checking it's location
-    cout << "Note frequency: [";
+    if(displayResults) {
+        cout << "Note frequency: [";
+    }
     for(int d=0; d < data.size(); ++d) {
         for (int i = 0; i < data.at(d).orientation.size(); ++i) {
             Note note;
             noteLocation = data.at(d).orientation.at(i);
 
             // Image to draw on, center Point, radius, color, thickness (-1 = fill)
-            circle(drawing, noteLocation, CIRCLE_RADIUS, colorBlue, CIRCLE_THICKNESS);
+            if(displayResults) {
+                circle(drawing, noteLocation, CIRCLE_RADIUS, colorBlue, CIRCLE_THICKNESS);
+            }
 
             // Check between/on which staff lines the note is sitting
             for (int a = 0; a < areas.size(); ++a) {
                 if (areas.at(a).contains(noteLocation)) {
                     frequency = _convertIndexToNoteFrequency(a);
-                    cout << frequency << "Hz, ";
+                    if(displayResults) {
+                        cout << frequency << "Hz, ";
+                    }
                     break;
                 }
             }
@@ -220,10 +234,13 @@ vector<Note> convertDataToNote(Mat input, vector<ContoursData> data, vector<Staf
             note.frequency = frequency;
             note.length = length;
             note.position = noteLocation.x;
+            note.row = noteLocation.y;
             notes.push_back(note);
         }
     }
-    cout << "]" << endl;
+    if(displayResults) {
+        cout << "]" << endl;
+    }
 
     /*
      * Because of template matching, the order of the notes is dropped. We can retrieve it by sorting the notes based
@@ -231,9 +248,11 @@ vector<Note> convertDataToNote(Mat input, vector<ContoursData> data, vector<Staf
      */
     sort(notes.begin(), notes.end(), sortNotesBySmallestPositionFirst);
 
-    cout << "Displaying matches notes and staff lines" << endl;
-    imshow("Matching notes with staff lines", drawing);
-    waitKey(0);
+    if(displayResults) {
+        cout << "Displaying matches notes and staff lines" << endl;
+        imshow("Matching notes with staff lines", drawing);
+        waitKey(0);
+    }
 
     return notes;
 }
\ No newline at end of file
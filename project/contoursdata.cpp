@@ -21,19 +21,82 @@
  */
 #include "notes.h"
 
+/*
+ * Private function to find the orientation of a note in getContoursData() and getContoursDataFromBank(). The centroid
+ * of the note in its bounding box moves towards the blob of the note.
+ *
+ * @param Mat img
+ * @param Rect box
+ * @param Point orientation
+ * @returns bool true if the orientation is found
+ * @author Dylan Van Assche
+ */
+bool _findNoteOrientation(Mat img, Rect box, Point &orientation) {
+    // Find the centroid of the image by using OpenCV Moments in the ROI (=bouding box)
+    Mat ROI = img(box);
+    // Mat, binaryImage=true
+    Moments m = moments(ROI, true);
+    Point centroid(m.m10/m.m00 + box.x, m.m01/m.m00 + box.y);
+
+    // Split bounding box in 2 parts to see where the blob of the note can be found.
+    Rect upperBox = Rect(Point(box.x, box.y), Point(box.x + box.width, box.y + box.height/2));
+    Rect lowerBox = Rect(Point(box.x, box.y + box.height/2), Point(box.x + box.width, box.y + box.height));
+
+    // RECT.contains() provides an easy way to check if a Point is laying inside that rectangle
+    if(lowerBox.contains(centroid)) {
+        orientation = Point(box.x + box.width, box.y + box.height);
+        return true;
+    }
+    else if(upperBox.contains(centroid)) {
+        orientation = Point(box.x, box.y);
+        return true;
+    }
+
+    cerr << "Centroid of the note lays outside the bounding box, this may not happen!" << endl;
+    return false;
+}
+
+/*
+ * Merges overlapping regions into their bounding box until no regions overlap. Used for the candidate regions in
+ * getContoursDataFromBank(), a note is searched in a single region this way.
+ *
+ * @param vector<Rect> regions
+ * @author Dylan Van Assche
+ */
+void mergeOverlappingRegions(vector<Rect> &regions) {
+    bool merged = true;
+
+    while(merged) {
+        merged = false;
+        for(int a=0; a < regions.size() && !merged; ++a) {
+            for(int b=a + 1; b < regions.size(); ++b) {
+                if((regions.at(a) & regions.at(b)).area() > 0) {
+                    regions.at(a) |= regions.at(b);
+                    regions.erase(regions.begin() + b);
+                    merged = true;
+                    break;
+                }
+            }
+        }
+    }
+}
+
 /*
  * Calculates the contours of the input image. Afterwards, it finds the orientation of the notes in the image by using
  * the centroid of the image. Thanks to the blob on each note, the centroid will move towards the blob. This way we can
  * find the orientation of the note in an easy way.
  *
+ * The copy of the input, the match result and the mask come from the workspace, the returned image keeps its buffer in
+ * use until the caller releases the ContoursData.
+ *
  * @param Mat input
  * @param NoteTemplate templ
  * @return ContoursData data
  * @author Dylan Van Assche
  */
 ContoursData getContoursData(Mat input, NoteTemplate templ) {
-    Mat img = input.clone();
-    Mat matchResult;
+    Mat img = acquireWorkspaceBuffer(input.size(), input.type());
+    Mat matchResult = acquireWorkspaceBuffer(Size(input.cols - templ.templ.cols + 1, input.rows - templ.templ.rows + 1), CV_32FC1);
     double minValue, maxValue;
     Point minLoc, maxLoc;
     vector<vector<Point> > contours;
@@ -41,6 +104,7 @@ ContoursData getContoursData(Mat input, NoteTemplate templ) {
     vector<Point> orientation;
     vector<double> length;
     vector<Rect> boxes;
+    input.copyTo(img);
 
     /*
      * Perform template matching on the image (for each template)
@@ -65,12 +129,10 @@ ContoursData getContoursData(Mat input, NoteTemplate templ) {
 
     /*
      * Create mask for multiple matching using a threshold match percentage
-     * Size(cols, rows), type of Mat
+     * Mat to threshold, threshold value, maximum possible value, mask (CV_8UC1, same size as the match result)
      */
-    Mat mask = Mat::zeros(Size(img.cols, img.rows), CV_32FC1);
-    // Mat to threshold, threshold value, maximum possible value, mask
+    Mat mask = acquireWorkspaceBuffer(matchResult.size(), CV_8UC1);
     inRange(matchResult, maxValue * ((double) TEMPLATE_MATCH_PERCENTAGE / 100.0), maxValue, mask);
-    mask.convertTo(mask, CV_8UC1);
 
     /*
      * Find contours
@@ -95,28 +157,12 @@ ContoursData getContoursData(Mat input, NoteTemplate templ) {
         Point p2(p1.x + templ.templ.cols, p1.y + templ.templ.rows);
         Rect box = Rect(p1, p2);
 
-        // Find the centroid of the image by using OpenCV Moments in the ROI (=bouding box)
-        Mat ROI = img(box);
-        // Mat, binaryImage=true
-        Moments m = moments(ROI, true);
-        Point centroid(m.m10/m.m00 + box.x, m.m01/m.m00 + box.y);
-
-        // Split bounding box in 2 parts to see where the blob of the note can be found.
-        Rect upperBox = Rect(Point(box.x, box.y), Point(box.x + box.width, box.y + box.height/2));
-        Rect lowerBox = Rect(Point(box.x, box.y + box.height/2), Point(box.x + box.width, box.y + box.height));
-
-        // RECT.contains() provides an easy way to check if a Point is laying inside that rectangle
-        if(lowerBox.contains(centroid)) {
-            orientation.push_back(Point(box.x + box.width, box.y + box.height));
-        }
-        else if(upperBox.contains(centroid)) {
-            orientation.push_back(Point(box.x, box.y));
-        }
-        else {
-            cerr << "Centroid of the note lays outside the bounding box, this may not happen!" << endl;
-            orientation.push_back(Point(-1, -1));
+        // Find the orientation of the note with the centroid
+        Point noteOrientation;
+        if(!_findNoteOrientation(img, box, noteOrientation)) {
             continue;
         }
+        orientation.push_back(noteOrientation);
 
         // Keep length and box associated with the note
         length.push_back(templ.length);
@@ -141,6 +187,177 @@ ContoursData getContoursData(Mat input, NoteTemplate templ) {
     return data;
 }
 
+/*
+ * Creates a bank of template variants: the template itself, upside down (stem down) and both rotated in steps of
+ * TEMPLATE_BANK_ROTATION_STEP degrees up to TEMPLATE_BANK_MAX_ROTATION degrees in both directions. The template must
+ * be inverted (white note on a black background) like the notes image, the corners of the rotated templates are black.
+ *
+ * @param NoteTemplate templ
+ * @returns vector<NoteTemplate> bank
+ * @author Dylan Van Assche
+ */
+vector<NoteTemplate> createTemplateBank(NoteTemplate templ) {
+    vector<NoteTemplate> bank;
+    Mat orientations[2];
+    orientations[0] = templ.templ;
+    // Flip around both axes = rotation by 180 degrees
+    flip(templ.templ, orientations[1], -1);
+
+    for(int o=0; o < 2; ++o) {
+        for(int angle = -TEMPLATE_BANK_MAX_ROTATION; angle <= TEMPLATE_BANK_MAX_ROTATION; angle += TEMPLATE_BANK_ROTATION_STEP) {
+            NoteTemplate variant;
+            variant.length = templ.length;
+
+            if(angle == 0) {
+                variant.templ = orientations[o];
+            }
+            else {
+                // Rotate around the center into a bigger image which contains the complete note
+                Point2f center(orientations[o].cols / 2.0, orientations[o].rows / 2.0);
+                Rect bounds = RotatedRect(center, orientations[o].size(), angle).boundingRect();
+                Mat rotation = getRotationMatrix2D(center, angle, 1.0);
+                rotation.at<double>(0, 2) += bounds.width / 2.0 - center.x;
+                rotation.at<double>(1, 2) += bounds.height / 2.0 - center.y;
+                warpAffine(orientations[o], variant.templ, rotation, bounds.size(), INTER_LINEAR, BORDER_CONSTANT, Scalar::all(0));
+            }
+
+            bank.push_back(variant);
+        }
+    }
+
+    return bank;
+}
+
+/*
+ * Finds the notes of all the templates in a bank in a single pass. Instead of matching every template with the
+ * complete image, the blobs of the notes image are used as candidate regions (grown by the size of the biggest
+ * template). All templates are scored with TM_CCOEFF_NORMED inside these regions only, so the scores of different
+ * templates can be compared and the cost of an extra template only depends on the size of the candidate regions.
+ *
+ * In each region the best template is kept for every position, the best scores above TEMPLATE_BANK_MIN_SCORE are
+ * notes. The positions around a note are suppressed to avoid double results. Like getContoursData(), the notes are
+ * removed from the returned image for further processing with other templates.
+ *
+ * @param Mat input
+ * @param vector<NoteTemplate> bank
+ * @return ContoursData data
+ * @author Dylan Van Assche
+ */
+ContoursData getContoursDataFromBank(Mat input, vector<NoteTemplate> bank) {
+    // Local copy: the incremental recognition calls this with another window size for every edit
+    Mat img;
+    vector<vector<Point> > blobs;
+    vector<Rect> regions;
+    vector<Rect> boxes;
+    ContoursData data;
+    Scalar colorBlack = Scalar::all(0);
+    Size maxSize(0, 0);
+    input.copyTo(img);
+
+    for(int v=0; v < bank.size(); ++v) {
+        maxSize.width = max(maxSize.width, bank.at(v).templ.cols);
+        maxSize.height = max(maxSize.height, bank.at(v).templ.rows);
+    }
+
+    // Candidate regions: every blob grown by the biggest template, overlapping regions are merged
+    findContours(img, blobs, CV_RETR_EXTERNAL, CHAIN_APPROX_SIMPLE);
+    for(int b=0; b < blobs.size(); ++b) {
+        Rect blob = boundingRect(blobs.at(b));
+        regions.push_back(Rect(blob.x - maxSize.width, blob.y - maxSize.height, blob.width + 2 * maxSize.width,
+                               blob.height + 2 * maxSize.height) & Rect(0, 0, img.cols, img.rows));
+    }
+    mergeOverlappingRegions(regions);
+
+    /*
+     * The score buffers are allocated once for the biggest region, every region uses a ROI of them. Their size depends
+     * on the content of the sheet: they are local instead of workspace buffers, each new size would push the buffers of
+     * the pipeline out of the workspace.
+     */
+    Size maxRegion(0, 0);
+    for(int r=0; r < regions.size(); ++r) {
+        maxRegion.width = max(maxRegion.width, regions.at(r).width);
+        maxRegion.height = max(maxRegion.height, regions.at(r).height);
+    }
+    Mat bestScoreBuffer(maxRegion, CV_32FC1);
+    Mat bestTemplateBuffer(maxRegion, CV_32SC1);
+    Mat scoreBuffer(maxRegion, CV_32FC1);
+    Mat betterBuffer(maxRegion, CV_8UC1);
+
+    for(int r=0; r < regions.size(); ++r) {
+        Rect region = regions.at(r);
+        Mat regionImg = img(region);
+
+        // Best score and template for each top left position of a template in the region
+        Mat bestScore = bestScoreBuffer(Rect(Point(0, 0), region.size()));
+        Mat bestTemplate = bestTemplateBuffer(Rect(Point(0, 0), region.size()));
+        bestScore.setTo(Scalar::all(-1));
+
+        for(int v=0; v < bank.size(); ++v) {
+            Mat templ = bank.at(v).templ;
+            if(templ.cols > region.width || templ.rows > region.height) {
+                continue;
+            }
+
+            Size resultSize(region.width - templ.cols + 1, region.height - templ.rows + 1);
+            Mat score = scoreBuffer(Rect(Point(0, 0), resultSize));
+            Mat better = betterBuffer(Rect(Point(0, 0), resultSize));
+            matchTemplate(regionImg, templ, score, TM_CCOEFF_NORMED);
+
+            Mat best = bestScore(Rect(Point(0, 0), resultSize));
+            compare(score, best, better, CMP_GT);
+            score.copyTo(best, better);
+            bestTemplate(Rect(Point(0, 0), resultSize)).setTo(Scalar::all(v), better);
+        }
+
+        // Take the best notes one by one and suppress the positions around them
+        while(true) {
+            double maxValue;
+            Point maxLoc;
+            minMaxLoc(bestScore, NULL, &maxValue, NULL, &maxLoc);
+            if(maxValue < TEMPLATE_BANK_MIN_SCORE) {
+                break;
+            }
+
+            NoteTemplate templ = bank.at(bestTemplate.at<int>(maxLoc));
+            Rect box(maxLoc + region.tl(), templ.templ.size());
+            Rect suppressed = Rect(maxLoc.x - templ.templ.cols / 2, maxLoc.y - templ.templ.rows / 2, templ.templ.cols,
+                                   templ.templ.rows) & Rect(Point(0, 0), region.size());
+            bestScore(suppressed).setTo(Scalar::all(-1));
+
+            // Find the orientation of the note with the centroid
+            Point noteOrientation;
+            if(!_findNoteOrientation(img, box, noteOrientation)) {
+                continue;
+            }
+
+            // Keep the contour (corners of the box), length and box associated with the note
+            vector<Point> corners;
+            corners.push_back(box.tl());
+            corners.push_back(Point(box.x + box.width - 1, box.y));
+            corners.push_back(box.br() - Point(1, 1));
+            corners.push_back(Point(box.x, box.y + box.height - 1));
+            data.contours.push_back(corners);
+            data.orientation.push_back(noteOrientation);
+            data.length.push_back(templ.length);
+            boxes.push_back(box);
+        }
+    }
+
+    /*
+     * Remove the notes from the image for further processing (avoid double results with other templates)
+     * image to draw on, Rect, color, thickness = -1 (complete fill)
+     */
+    for(int b=0; b < boxes.size(); ++b) {
+        rectangle(img, boxes.at(b), colorBlack, RECTANGLE_THICKNESS);
+    }
+
+    // Combine the extracted data into a ContoursData struct
+    data.image = img;
+    data.templ = bank.at(0);
+    data.box = boxes;
+    return data;
+}
+
 /*
  * Draws the contours on the complete image and displays it.
  *
@@ -0,0 +1,104 @@
+/*
+ * @title Labo beeldinterpretatie 2018: project
+ * @author Dylan Van Assche
+ *
+ * ---> BASIC MUSIC NOTES RECOGNITION: SYNTHETIC SHEETS GENERATOR <---
+ *
+ * Generates synthetic music sheets together with their ground truth notes, to measure the scaling and accuracy of the
+ * recognition without copyrighted scans.
+ *
+ * Output in the (existing) output directory:
+ *  - sheet_000.png, sheet_001.png, ...: the music sheets.
+ *  - sheet_000.csv, sheet_001.csv, ...: the ground truth notes of each sheet (see saveGroundTruth()).
+ *  - quarter-note.png and double-eighth-note.png: the templates of the notes at the same resolution.
+ *
+ * Usage:
+ *  - cmake CMakeLists.txt
+ *  - make
+ *  - ./generator --output=corpus --count=10 --dpi=300 --systems=6 --density=0.8 --note-types=quarter,double-eighth \
+ *    --flipped=0.1 --skew=0.5 --noise=10 --seed=2018
+ *
+ */
+#include <iomanip>
+#include "notes.h"
+
+int main(int argc, const char** argv) {
+    CommandLineParser parser(argc, argv,
+                 "{ help h usage ?  |                             | Shows this message.                             }"
+                 "{ output o        |                             | Existing output directory <REQUIRED>            }"
+                 "{ count c         | 1                           | Number of sheets                                }"
+                 "{ width-mm        | 210                         | Page width in mm                                }"
+                 "{ height-mm       | 297                         | Page height in mm                               }"
+                 "{ dpi             | 300                         | Resolution in dots per inch                     }"
+                 "{ systems         | 6                           | Number of staff systems per page                }"
+                 "{ density         | 0.8                         | Probability that a slot contains a note [0, 1]  }"
+                 "{ note-types      | quarter,double-eighth       | Note types on the sheet                         }"
+                 "{ flipped         | 0                           | Probability of an upside down note [0, 1]       }"
+                 "{ skew            | 0                           | Maximum page rotation in degrees                }"
+                 "{ noise           | 0                           | Standard deviation of the Gaussian noise        }"
+                 "{ seed            | 2018                        | Random generator seed                           }"
+    );
+
+    // Help printing
+    if(parser.has("help") || argc <= 1) {
+        parser.printMessage();
+        return 0;
+    }
+
+    // Parser fail
+    if (!parser.check()) {
+        parser.printErrors();
+        return -1;
+    }
+
+    // Required arguments supplied?
+    string output(parser.get<string>("output"));
+    string noteTypes(parser.get<string>("note-types"));
+    int count = parser.get<int>("count");
+    SheetConfig config = defaultSheetConfig();
+    config.widthMm = parser.get<double>("width-mm");
+    config.heightMm = parser.get<double>("height-mm");
+    config.dpi = parser.get<int>("dpi");
+    config.systems = parser.get<int>("systems");
+    config.density = parser.get<double>("density");
+    config.quarterNotes = noteTypes.find("quarter") != string::npos;
+    config.doubleEighthNotes = noteTypes.find("double-eighth") != string::npos;
+    config.flipped = parser.get<double>("flipped");
+    config.skew = parser.get<double>("skew");
+    config.noise = parser.get<double>("noise");
+    RNG rng(parser.get<int>("seed"));
+
+    if(output.empty() || count <= 0 || config.dpi <= 0 || config.systems <= 0 || config.widthMm <= 2 * SHEET_MARGIN_MM
+       || config.heightMm <= 2 * SHEET_MARGIN_MM || (!config.quarterNotes && !config.doubleEighthNotes)) {
+        cerr << "Please supply your parameters using command line arguments: "
+        << "--output=corpus "
+        << "--note-types=quarter,double-eighth "
+        << "and a positive count, DPI, number of systems and a page bigger than the margins"
+        << endl;
+        return -2;
+    }
+
+    // Templates at the same resolution as the sheets
+    if(!imwrite(output + "/quarter-note.png", renderNoteTemplate(config, GLYPH_QUARTER))
+       || !imwrite(output + "/double-eighth-note.png", renderNoteTemplate(config, GLYPH_DOUBLE_EIGHTH))) {
+        cerr << "Writing the templates failed, please verify that the output directory exists." << endl;
+        return -3;
+    }
+
+    for(int i=0; i < count; ++i) {
+        stringstream name;
+        name << output << "/sheet_" << setw(3) << setfill('0') << i;
+
+        vector<GroundTruthNote> truth;
+        Mat sheet = renderSheet(config, rng, truth);
+        if(!imwrite(name.str() + ".png", sheet) || !saveGroundTruth(name.str() + ".csv", truth)) {
+            cerr << "Writing sheet '" << name.str() << "' failed." << endl;
+            return -3;
+        }
+
+        cout << "Saved sheet '" << name.str() << ".png' (" << sheet.cols << "x" << sheet.rows << "px) with "
+             << truth.size() << " notes" << endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,268 @@
+/*
+ * @title Labo beeldinterpretatie 2018: project
+ * @author Dylan Van Assche
+ *
+ * ---> BASIC MUSIC NOTES RECOGNITION <---
+ *
+ * This Proof-Of-Concept (POC) can extract the music notes from a music sheet and save the sound of them into a
+ * WAV audio file.
+ *
+ * Features:
+ *  - Detect non-rotated 1/4 and 1/16 notes using template matching.
+ *  - Find the tone height of each note using the staff lines extraction and vertical histograms.
+ *  - Merge both into a music tone and save it to a WAV audio file using a WAV library.
+ *
+ * Usage:
+ *  - cmake CMakeLists.txt
+ *  - make
+ *  - ./project --sheet=musicSheet.png --output=output.wav --quarter-note=quarter-note.png \
+ *    --double-eighth-note=double-eighth-note.png
+ *
+ */
+#include "notes.h"
+
+// std::sort helper function
+bool sortCachedNotesBySmallestPositionFirst(const Note &a, const Note &b) {
+    return a.position < b.position; // smallest first
+}
+
+/*
+ * Private function to grow a region on every side, clipped to the bounds of the image.
+ *
+ * @param Rect region
+ * @param int dx
+ * @param int dy
+ * @param Size bounds
+ * @returns Rect grown region
+ * @author Dylan Van Assche
+ */
+Rect _growRegion(Rect region, int dx, int dy, Size bounds) {
+    return Rect(region.x - dx, region.y - dy, region.width + 2 * dx, region.height + 2 * dy) & Rect(Point(0, 0), bounds);
+}
+
+/*
+ * Private function to extract the lines (see splitStaffLinesAndNotes()) of a region again. The erosion and dilation
+ * can each reach half a structure element far, the region is processed together with a full structure element on every
+ * side so the result is identical to processing the complete image.
+ *
+ * @param Mat binary
+ * @param Mat lines, updated in place
+ * @param Rect region
+ * @param Mat structure
+ * @returns Rect bounding box of the changed pixels, empty if nothing changed
+ * @author Dylan Van Assche
+ */
+Rect _updateLines(Mat binary, Mat lines, Rect region, Mat structure) {
+    Rect window = _growRegion(region, structure.cols, structure.rows, binary.size());
+    Mat updated, difference;
+    vector<Point> changed;
+
+    erode(binary(window), updated, structure, Point(-1, -1));
+    dilate(updated, updated, structure, Point(-1, -1));
+    updated = updated(Rect(region.tl() - window.tl(), region.size()));
+
+    absdiff(updated, lines(region), difference);
+    findNonZero(difference, changed);
+    updated.copyTo(lines(region));
+
+    if(changed.empty()) {
+        return Rect();
+    }
+    return boundingRect(changed) + region.tl();
+}
+
+/*
+ * Private function to detect the notes in a window of the cached notes image, like main.cpp does for the complete
+ * image. The window always spans the complete height so the staff lines are valid.
+ *
+ * @param RecognitionCache cache
+ * @param Rect window
+ * @returns vector<Note> notes with their position in the complete image
+ * @author Dylan Van Assche
+ */
+vector<Note> _detectNotes(RecognitionCache &cache, Rect window) {
+    Mat notesImg = cache.noteSheet.notes(window);
+    ContoursData contoursDoubleEight = getContoursDataFromBank(notesImg, cache.doubleEighthBank);
+    ContoursData contoursQuarter = getContoursDataFromBank(contoursDoubleEight.image, cache.quarterBank);
+
+    vector<ContoursData> data;
+    data.push_back(contoursDoubleEight);
+    data.push_back(contoursQuarter);
+    vector<Note> notes = convertDataToNote(notesImg, data, cache.distances, window.height, window.width);
+    for(int n=0; n < notes.size(); ++n) {
+        notes.at(n).position += window.x;
+        notes.at(n).row += window.y;
+    }
+
+    return notes;
+}
+
+/*
+ * Recognizes a complete sheet and keeps every intermediate result, so updateRecognition() can recompute only the parts
+ * of a new version of the sheet which changed. Notes are detected with the template banks (see
+ * getContoursDataFromBank()): their scores only depend on the neighbourhood of a note, unlike the normalization of
+ * getContoursData() over the complete image.
+ *
+ * @param Mat sheet
+ * @param NoteTemplate doubleEighthTempl, inverted
+ * @param NoteTemplate quarterTempl, inverted
+ * @param Binarization method
+ * @returns RecognitionCache cache
+ * @author Dylan Van Assche
+ */
+RecognitionCache createRecognitionCache(Mat sheet, NoteTemplate doubleEighthTempl, NoteTemplate quarterTempl, Binarization method) {
+    RecognitionCache cache;
+    cache.sheet = sheet.clone();
+    cache.method = method;
+    cache.doubleEighthTempl = doubleEighthTempl;
+    cache.quarterTempl = quarterTempl;
+    cache.doubleEighthBank = createTemplateBank(doubleEighthTempl);
+    cache.quarterBank = createTemplateBank(quarterTempl);
+
+    cache.noteSheet = splitStaffLinesAndNotes(cache.sheet, method);
+    cache.distances = getStaffLineDistances(cache.noteSheet.staffLines);
+    cache.notes = _detectNotes(cache, Rect(0, 0, sheet.cols, sheet.rows));
+
+    return cache;
+}
+
+/*
+ * Updates the cached recognition to a new version of the sheet, for example after removing a smudge in one measure.
+ * The new sheet is compared with the cached one in tiles of INCREMENTAL_TILE_SIZE pixels, only the footprints of the
+ * changed tiles are recomputed:
+ *  - Preprocessing: the tile + PREPROCESS_HALO pixels (see preprocessSheet()).
+ *  - Lines extraction: the preprocessed region + the size of the structure element in its direction.
+ *  - Staff lines: found again if the horizontal lines changed. If they moved, every note is detected again.
+ *  - Notes: only in the columns where the notes image changed, grown by the size of the templates. The cached notes in
+ *    these columns are replaced by the new ones.
+ * A sheet with another size is recognized completely.
+ *
+ * @param RecognitionCache cache
+ * @param Mat sheet
+ * @returns vector<Rect> changed tiles
+ * @author Dylan Van Assche
+ */
+vector<Rect> updateRecognition(RecognitionCache &cache, Mat sheet) {
+    Rect page(0, 0, sheet.cols, sheet.rows);
+    vector<Rect> dirty;
+
+    if(sheet.size() != cache.sheet.size() || sheet.type() != cache.sheet.type()) {
+        cache = createRecognitionCache(sheet, cache.doubleEighthTempl, cache.quarterTempl, cache.method);
+        dirty.push_back(page);
+        return dirty;
+    }
+
+    // Find the changed tiles and keep the new version of them
+    for(int y=0; y < sheet.rows; y += INCREMENTAL_TILE_SIZE) {
+        for(int x=0; x < sheet.cols; x += INCREMENTAL_TILE_SIZE) {
+            Rect tile = Rect(x, y, INCREMENTAL_TILE_SIZE, INCREMENTAL_TILE_SIZE) & page;
+            if(norm(sheet(tile), cache.sheet(tile), NORM_INF) > 0) {
+                sheet(tile).copyTo(cache.sheet(tile));
+                dirty.push_back(tile);
+            }
+        }
+    }
+
+    if(dirty.empty()) {
+        return dirty;
+    }
+
+    // Preprocessing footprint, neighbouring tiles overlap and are merged
+    vector<Rect> binaryRegions;
+    for(int d=0; d < dirty.size(); ++d) {
+        binaryRegions.push_back(_growRegion(dirty.at(d), PREPROCESS_HALO, PREPROCESS_HALO, sheet.size()));
+    }
+    mergeOverlappingRegions(binaryRegions);
+
+    // All regions are preprocessed before the lines extraction reads their neighbourhood
+    for(int r=0; r < binaryRegions.size(); ++r) {
+        Rect region = binaryRegions.at(r);
+        Rect window = _growRegion(region, PREPROCESS_HALO, PREPROCESS_HALO, sheet.size());
+        Mat binary;
+        preprocessSheet(cache.sheet(window), binary, cache.method);
+        binary(Rect(region.tl() - window.tl(), region.size())).copyTo(cache.noteSheet.binary(region));
+    }
+
+    // Lines extraction footprint, same structure elements as splitStaffLinesAndNotes()
+    Mat horizontalStructure = getStructuringElement(MORPH_RECT, Size(sheet.cols / HORIZONTAL_DIVIDER, HORIZONTAL_HEIGHT));
+    Mat verticalStructure = getStructuringElement(MORPH_RECT, Size(VERTICAL_WIDTH, sheet.rows / VERTICAL_DIVIDER));
+    vector<Rect> horizontalRegions, verticalRegions;
+    for(int r=0; r < binaryRegions.size(); ++r) {
+        horizontalRegions.push_back(_growRegion(binaryRegions.at(r), horizontalStructure.cols, horizontalStructure.rows, sheet.size()));
+        verticalRegions.push_back(_growRegion(binaryRegions.at(r), verticalStructure.cols, verticalStructure.rows, sheet.size()));
+    }
+    mergeOverlappingRegions(horizontalRegions);
+    mergeOverlappingRegions(verticalRegions);
+
+    bool staffLinesChanged = false;
+    for(int r=0; r < horizontalRegions.size(); ++r) {
+        Rect changed = _updateLines(cache.noteSheet.binary, cache.noteSheet.staffLines, horizontalRegions.at(r), horizontalStructure);
+        staffLinesChanged |= changed.area() > 0;
+    }
+
+    vector<Rect> changedNotes;
+    for(int r=0; r < verticalRegions.size(); ++r) {
+        Rect changed = _updateLines(cache.noteSheet.binary, cache.noteSheet.notes, verticalRegions.at(r), verticalStructure);
+        if(changed.area() > 0) {
+            changedNotes.push_back(changed);
+        }
+    }
+
+    // Moved staff lines change the frequency of every note
+    if(staffLinesChanged) {
+        vector<StaffLineData> distances = getStaffLineDistances(cache.noteSheet.staffLines);
+        bool moved = distances.size() != cache.distances.size();
+        for(int d=0; d < distances.size() && !moved; ++d) {
+            moved = distances.at(d).position != cache.distances.at(d).position;
+        }
+
+        cache.distances = distances;
+        if(moved) {
+            cache.notes = _detectNotes(cache, page);
+            return dirty;
+        }
+    }
+
+    /*
+     * Columns where the notes can change: a changed pixel is covered by templates up to a template width on both sides.
+     * Removing a double eighth note changes the quarter notes detected in its box too, so 2 template widths are used.
+     */
+    int maxWidth = 0;
+    for(int v=0; v < cache.doubleEighthBank.size(); ++v) {
+        maxWidth = max(maxWidth, cache.doubleEighthBank.at(v).templ.cols);
+    }
+    for(int v=0; v < cache.quarterBank.size(); ++v) {
+        maxWidth = max(maxWidth, cache.quarterBank.at(v).templ.cols);
+    }
+
+    vector<Rect> bands;
+    for(int c=0; c < changedNotes.size(); ++c) {
+        bands.push_back(Rect(changedNotes.at(c).x - 2 * maxWidth, 0, changedNotes.at(c).width + 4 * maxWidth, sheet.rows) & page);
+    }
+    mergeOverlappingRegions(bands);
+
+    // Replace the cached notes in each band by the notes detected in the band + a template width on both sides
+    for(int b=0; b < bands.size(); ++b) {
+        Rect band = bands.at(b);
+        vector<Note> detected = _detectNotes(cache, _growRegion(band, maxWidth, 0, sheet.size()));
+        vector<Note> patched;
+
+        for(int n=0; n < cache.notes.size(); ++n) {
+            double position = cache.notes.at(n).position;
+            if(position < band.x || position >= band.x + band.width) {
+                patched.push_back(cache.notes.at(n));
+            }
+        }
+        for(int n=0; n < detected.size(); ++n) {
+            double position = detected.at(n).position;
+            if(position >= band.x && position < band.x + band.width) {
+                patched.push_back(detected.at(n));
+            }
+        }
+
+        cache.notes = patched;
+    }
+    sort(cache.notes.begin(), cache.notes.end(), sortCachedNotesBySmallestPositionFirst);
+
+    return dirty;
+}
@@ -8,15 +8,23 @@
  * WAV audio file.
  *
  * Features:
- *  - Detect non-rotated 1/4 and 1/16 notes using template matching.
+ *  - Detect 1/4 and 1/16 notes using template matching, also upside down (stem down) and slightly rotated notes.
  *  - Find the tone height of each note using the staff lines extraction and vertical histograms.
  *  - Merge both into a music tone and save it to a WAV audio file using a WAV library.
+ *  - Place the notes in time by their measure, using the staff and bar lines of each staff system.
  *
  * Usage:
  *  - cmake CMakeLists.txt
  *  - make
  *  - ./project --sheet=musicSheet.png --output=output.wav --quarter-note=quarter-note.png \
  *    --double-eighth-note=double-eighth-note.png
+ *  - Optional: --binarization=gaussian|mean|sauvola selects the adaptive threshold method (default: gaussian).
+ *  - Optional: --detection=template|bank selects only the upright templates (default) or the template bank with
+ *    flipped and rotated notes. TEMPLATE_BANK_MIN_SCORE isn't calibrated on real sheets yet.
+ *  - Optional: --stream=-|pipe streams the sound as raw PCM (S16_LE, mono, 44100 Hz) to stdout or a named pipe while
+ *    the staff systems are recognized, instead of the interactive windows and the WAV file (see streamSheet()):
+ *    ./project --sheet=musicSheet.png --quarter-note=quarter-note.png --double-eighth-note=double-eighth-note.png \
+ *    --stream=- | aplay -f S16_LE -c 1 -r 44100
  *
  */
 #include "notes.h"
@@ -28,6 +36,9 @@ int main(int argc, const char** argv) {
                  "{ output o                          | | Path to the sound output file <REQUIRED>                  }"
                  "{ quarter-note quarter              | | Loads an image of a quarter note symbol <REQUIRED>        }"
                  "{ double-eighth-note double-eighth  | | Loads an image of a double-eighth note symbol <REQUIRED>  }"
+                 "{ binarization b                    | gaussian | Adaptive threshold: gaussian, mean or sauvola   }"
+                 "{ detection d                       | template | Note detection: template or bank                }"
+                 "{ stream                            |          | Streams the sound while recognizing: - or a pipe }"
     );
 
     // Help printing
@@ -48,7 +59,8 @@ int main(int argc, const char** argv) {
     string outputSoundPath(parser.get<string>("output"));
     string quarterNote(parser.get<string>("quarter"));
     string doubleEighthNote(parser.get<string>("double-eighth"));
-    if(sheet.empty() || outputSoundPath.empty() || quarterNote.empty() || doubleEighthNote.empty()) {
+    string stream(parser.get<string>("stream"));
+    if(sheet.empty() || (outputSoundPath.empty() && stream.empty()) || quarterNote.empty() || doubleEighthNote.empty()) {
         cerr << "Please supply your parameters using command line arguments: "
         << "--sheet=sheet.png "
         << "--output=ouput.wav "
@@ -58,6 +70,18 @@ int main(int argc, const char** argv) {
         return -2;
     }
 
+    int binarization = binarizationFromName(parser.get<string>("binarization"));
+    if(binarization < 0) {
+        cerr << "Unknown binarization method, please use: --binarization=gaussian|mean|sauvola" << endl;
+        return -2;
+    }
+
+    string detection(parser.get<string>("detection"));
+    if(detection != "bank" && detection != "template") {
+        cerr << "Unknown note detection, please use: --detection=template|bank" << endl;
+        return -2;
+    }
+
     // Try to load images
     Mat sheetImg, quarterImg, doubleEighthImg;
     sheetImg = imread(sheet, IMREAD_GRAYSCALE);
@@ -69,6 +93,21 @@ int main(int argc, const char** argv) {
         return -3;
     }
 
+    /*
+     * Streaming preview: headless, the sound is streamed as raw PCM while the staff systems are recognized one by one.
+     * stdout is reserved for the samples, messages go to stderr.
+     */
+    if(!stream.empty()) {
+        displayResults = false;
+        NoteTemplate doubleEighthTempl;
+        doubleEighthTempl.templ = ~doubleEighthImg;
+        doubleEighthTempl.length = NOTE_LENGTH_16;
+        NoteTemplate quarterTempl;
+        quarterTempl.templ = ~quarterImg;
+        quarterTempl.length = NOTE_LENGTH_4;
+        return streamSheet(sheetImg, doubleEighthTempl, quarterTempl, (Binarization) binarization, detection == "bank", stream);
+    }
+
     // Displays the images in a window
     cout << "Displaying input" << endl;
     namedWindow("Sheet image", WINDOW_AUTOSIZE);
@@ -87,52 +126,90 @@ int main(int argc, const char** argv) {
     quarterTempl.templ = quarterImg;
     quarterTempl.length = NOTE_LENGTH_4;
 
-    // Split stafflines from input image
-    NoteSheet noteSheet = splitStaffLinesAndNotes(sheetImg);
-    cout << "Displaying split between notes and staff lines" << endl;
-    imshow("Splitting notes", noteSheet.notes);
-    imshow("Splitting staff lines", noteSheet.staffLines);
-    waitKey(0);
-
     /*
-     * Find contours and display them
-     *
-     * /!\ To keep this a proof of concept, only non rotated notes are detected.
-     *     If you would like to detect notes that are drawn upside down, you can do the same steps as below
-     *     but with your input image or template rotated by 180 degrees.
+     * The staff lines of a system give the pitch and the bar lines of that system only: every staff system is cut from
+     * the sheet with its surroundings and recognized like a sheet with a single system (see findStaffSystems()). A
+     * sheet without complete systems is recognized as a whole.
      */
+    vector<Rect> systems = staffSystemsOrSheet(sheetImg, findStaffSystems(sheetImg));
+
     // Input image is inverted too
     doubleEighthImg = ~doubleEighthImg;
     quarterImg = ~quarterImg;
+    vector<NoteTemplate> doubleEighthBank, quarterBank;
+    if(detection == "bank") {
+        doubleEighthBank = createTemplateBank(doubleEighthTempl);
+        quarterBank = createTemplateBank(quarterTempl);
+    }
 
-    // Find double eight notes
-    ContoursData contoursDoubleEight = getContoursData(noteSheet.notes, doubleEighthTempl);
-    drawContoursWithOrientation(noteSheet.notes, contoursDoubleEight, sheetImg.rows, sheetImg.cols);
-
-    // Find quarter notes (double eight notes are removed in the previous step)
-    ContoursData contoursQuarter = getContoursData(contoursDoubleEight.image, quarterTempl);
-    drawContoursWithOrientation(noteSheet.notes, contoursQuarter, sheetImg.rows, sheetImg.cols);
-
-    // Find the distances between the staff lines
-    vector<StaffLineData> distances = getStaffLineDistances(noteSheet.staffLines);
+    Timeline timeline;
+    timeline.length = 0;
+    for(int s=0; s < systems.size(); ++s) {
+        Rect system = systems.at(s);
+        cout << "Staff system " << s + 1 << "/" << systems.size() << ": " << system << endl;
+
+        // Split stafflines from input image
+        NoteSheet noteSheet = splitStaffLinesAndNotes(sheetImg(system), (Binarization) binarization);
+        cout << "Displaying split between notes and staff lines" << endl;
+        imshow("Splitting notes", noteSheet.notes);
+        imshow("Splitting staff lines", noteSheet.staffLines);
+        waitKey(0);
+
+        /*
+         * Find contours and display them
+         *
+         * Notes drawn upside down or slightly rotated are found with a bank of flipped and rotated templates, all
+         * scored in the same pass inside the candidate regions (see getContoursDataFromBank()). The template detection
+         * only matches the upright templates with the complete image.
+         */
+        // Find double eight notes
+        ContoursData contoursDoubleEight;
+        if(detection == "bank") {
+            contoursDoubleEight = getContoursDataFromBank(noteSheet.notes, doubleEighthBank);
+        }
+        else {
+            contoursDoubleEight = getContoursData(noteSheet.notes, doubleEighthTempl);
+        }
+        drawContoursWithOrientation(noteSheet.notes, contoursDoubleEight, system.height, system.width);
+
+        // Find quarter notes (double eight notes are removed in the previous step)
+        ContoursData contoursQuarter;
+        if(detection == "bank") {
+            contoursQuarter = getContoursDataFromBank(contoursDoubleEight.image, quarterBank);
+        }
+        else {
+            contoursQuarter = getContoursData(contoursDoubleEight.image, quarterTempl);
+        }
+        drawContoursWithOrientation(noteSheet.notes, contoursQuarter, system.height, system.width);
+
+        // Find the distances between the staff lines
+        vector<StaffLineData> distances = getStaffLineDistances(noteSheet.staffLines);
+
+        cout << "Staff line position: [";
+        for(int d=0; d < distances.size(); ++d) {
+            cout << distances.at(d).position + system.y << "px, ";
+        }
+        cout << "]" << endl;
+
+        vector<ContoursData> data;
+        data.push_back(contoursDoubleEight);
+        data.push_back(contoursQuarter);
+        vector<Note> notes = convertDataToNote(noteSheet.notes, data, distances, system.height, system.width);
+
+        // Place the notes on a timeline using the measures of the system, systems follow each other
+        appendTimeline(timeline, buildTimeline(noteSheet.notes, notes, distances), s, system.y);
+    }
 
-    cout << "Staff line position: [";
-    for(int d=0; d < distances.size(); ++d) {
-        cout << distances.at(d).position << "px, ";
+    cout << "Timeline: [";
+    for(int n=0; n < timeline.notes.size(); ++n) {
+        cout << timeline.notes.at(n).note.frequency << "Hz @ " << timeline.notes.at(n).onset << " (measure "
+             << timeline.notes.at(n).measure << " of system " << timeline.notes.at(n).system << "), ";
     }
     cout << "]" << endl;
 
-    vector<ContoursData> data;
-    data.push_back(contoursDoubleEight);
-    data.push_back(contoursQuarter);
-    vector<Note> notes = convertDataToNote(noteSheet.notes, data, distances, sheetImg.rows, sheetImg.cols);
-
     // Generate wave
-    vector<vector<short> > waves;
-    for(int n=0; n < notes.size(); ++n) {
-        waves.push_back(generateWaveform(notes.at(n).frequency, notes.at(n).length));
-    }
-    saveWaveforms(outputSoundPath, waves);
+    vector<short> wave = renderTimeline(timeline);
+    saveWaveform(outputSoundPath, wave);
 
     // Wait until the user decides to exit the program.
     return 0;
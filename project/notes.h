@@ -16,6 +16,9 @@ extern "C" {
 #define THRESHOLD_BLOCK_SIZE 25
 #define THRESHOLD_C -2
 #define TEMPLATE_MATCH_PERCENTAGE 99.0
+#define TEMPLATE_BANK_MIN_SCORE 0.6 // TM_CCOEFF_NORMED score of a note in the template bank
+#define TEMPLATE_BANK_ROTATION_STEP 5 // degrees
+#define TEMPLATE_BANK_MAX_ROTATION 5 // degrees, upright and flipped templates are rotated in both directions
 #define ERODE_DILATE_ITER 5
 #define HORIZONTAL_DIVIDER 30
 #define VERTICAL_DIVIDER 30
@@ -23,6 +26,24 @@ extern "C" {
 #define VERTICAL_WIDTH 1
 #define REDUCE_DIMENSION 1
 #define NUMBER_OF_STAFF_LINES 5
+#define SAUVOLA_K 0.2 // sensitivity to the local contrast
+#define SAUVOLA_R 128.0 // dynamic range of the standard deviation
+
+// Parallelism
+#define PREPROCESS_HALO (2 * ERODE_DILATE_ITER + THRESHOLD_BLOCK_SIZE / 2) // pixels influenced by the opening + threshold
+#define PREPROCESS_TILE_SIZE 256 // 2 buffers of (256 + 2 * halo)^2 pixels fit in a 256 KB L2 cache
+#define NUMBER_OF_LINE_BRANCHES 2 // horizontal + vertical lines
+#define WORKSPACE_MAX_BUFFERS 32 // per thread, the least recently used free buffers are dropped above this
+
+// Streaming
+#define STAFF_LINE_COVERAGE 0.5 // part of the width a staff line covers in the dark pixels of the sheet
+#define DARK_PIXEL 128 // gray value below which a pixel is ink
+#define STREAM_RING_CAPACITY 1024 // notes, power of 2
+#define STREAM_POLL_US 1000 // wait time when the ring buffer is empty or full
+#define STREAM_CHUNK_SAMPLES 1024 // samples written to the sink at once
+
+// Incremental recognition
+#define INCREMENTAL_TILE_SIZE 64 // granularity of the difference with the cached sheet
 
 // Drawing
 #define CIRCLE_RADIUS 3
@@ -32,7 +53,8 @@ extern "C" {
 #define CONTOURS_MAX_LEVEL 0
 
 // Sound
-#define NOTE_LENGTH (2 * WAVFILE_SAMPLES_PER_SECOND)
+#define TEMPO 120 // quarter notes per minute
+#define NOTE_LENGTH (4 * 60 * WAVFILE_SAMPLES_PER_SECOND / TEMPO) // whole note
 #define NOTE_LENGTH_16 NOTE_LENGTH/16 // 1/16 note
 #define NOTE_LENGTH_4 NOTE_LENGTH/4 // 1/4 note
 #define VOLUME 32000
@@ -43,13 +65,59 @@ extern "C" {
 #define NOTE_G 392.0
 #define NOTE_A 440.0
 #define NOTE_B 493.9
+#define MEASURE_LENGTH (BEATS_PER_MEASURE * NOTE_LENGTH_4) // 4/4 time
+#define BAR_LINE_COVERAGE 0.9 // part of the staff height a bar line covers in the notes image
+
+// Synthetic sheets
+#define STAFF_SPACE_MM 1.75 // distance between 2 staff lines, 7 mm staff height
+#define STAFF_LINE_MM 0.15
+#define SHEET_MARGIN_MM 15.0
+#define SLOT_WIDTH 4.0 // in staff spaces, a double eighth note takes 2 slots
+#define BEATS_PER_MEASURE 4
+#define STEM_LENGTH 3.5 // in staff spaces
+#define HIGHEST_STAFF_POSITION -1 // G above the staff, positions are counted in half staff spaces from the top line
+#define LOWEST_STAFF_POSITION 9 // D below the staff
 
 using namespace std;
 using namespace cv;
 
+typedef enum Binarization {
+    BINARIZE_GAUSSIAN, // OpenCV ADAPTIVE_THRESH_GAUSSIAN_C
+    BINARIZE_MEAN, // Integral image mean
+    BINARIZE_SAUVOLA // Integral image Sauvola
+} Binarization;
+
+typedef enum GlyphType {
+    GLYPH_QUARTER,
+    GLYPH_DOUBLE_EIGHTH
+} GlyphType;
+
+typedef struct SheetConfig {
+    double widthMm;
+    double heightMm;
+    int dpi;
+    int systems;
+    double density; // probability that a slot contains a note
+    bool quarterNotes;
+    bool doubleEighthNotes;
+    double flipped; // probability that a note is drawn upside down (stem down)
+    double skew; // maximum rotation of the page in degrees
+    double noise; // standard deviation of the Gaussian noise
+} SheetConfig;
+
+typedef struct GroundTruthNote {
+    int system;
+    int measure;
+    Rect box;
+    double frequency;
+    double length;
+    bool flipped;
+} GroundTruthNote;
+
 typedef struct NoteSheet {
     Mat notes;
     Mat staffLines;
+    Mat binary; // preprocessed sheet both are extracted from
 } NoteSheet;
 
 typedef struct NoteTemplate {
@@ -76,15 +144,78 @@ typedef struct Note {
     double frequency;
     double length;
     double position;
+    double row; // vertical position, to find the staff system of the note
 } Note;
 
-NoteSheet splitStaffLinesAndNotes(Mat input);
+typedef struct TimedNote {
+    Note note;
+    int system;
+    int measure;
+    int onset; // samples since the start of the sheet
+    int length; // samples
+} TimedNote;
+
+typedef struct Timeline {
+    vector<TimedNote> notes; // sorted by onset
+    int length; // samples
+} Timeline;
+
+typedef struct RecognitionCache {
+    Mat sheet;
+    NoteSheet noteSheet;
+    vector<StaffLineData> distances;
+    vector<Note> notes; // sorted by position
+    NoteTemplate doubleEighthTempl;
+    NoteTemplate quarterTempl;
+    vector<NoteTemplate> doubleEighthBank;
+    vector<NoteTemplate> quarterBank;
+    Binarization method;
+} RecognitionCache;
+
+extern bool displayResults;
+
+int binarizationFromName(string name);
+void binarizeSheet(Mat inverted, Mat &binary, Binarization method = BINARIZE_GAUSSIAN, int blockSize = THRESHOLD_BLOCK_SIZE);
+void preprocessSheet(Mat input, Mat &binary, Binarization method = BINARIZE_GAUSSIAN);
+void preprocessSheetReference(Mat input, Mat &binary);
+NoteSheet splitStaffLinesAndNotes(Mat input, Binarization method = BINARIZE_GAUSSIAN);
 void drawHistogram(Mat histogram, int rows, int cols);
 ContoursData getContoursData(Mat input, NoteTemplate templ);
+vector<NoteTemplate> createTemplateBank(NoteTemplate templ);
+ContoursData getContoursDataFromBank(Mat input, vector<NoteTemplate> bank);
+void mergeOverlappingRegions(vector<Rect> &regions);
 void drawContoursWithOrientation(Mat input, ContoursData data, int rows, int cols);
 vector<StaffLineData> getStaffLineDistances(Mat input);
+vector<Rect> findStaffSystems(Mat sheet);
+vector<Rect> staffSystemsOrSheet(Mat sheet, vector<Rect> systems);
 vector<Note> convertDataToNote(Mat input, vector<ContoursData> data, vector<StaffLineData> staffLineDistances, int rows, int cols);
 vector<short> generateWaveform(double frequency, double length);
 void saveWaveforms(string outputPath, vector< vector<short> > waveforms);
+void mixWaveform(vector<short> &output, int onset, double frequency, int length);
+void saveWaveform(string outputPath, const vector<short> &waveform);
+vector<int> findBarLines(Mat notesImage, int top, int bottom);
+Timeline buildTimeline(Mat notesImage, vector<Note> notes, vector<StaffLineData> staffLineDistances);
+void appendTimeline(Timeline &timeline, Timeline systemTimeline, int system, int rowOffset);
+vector<short> renderTimeline(Timeline timeline);
+int streamSheet(Mat sheet, NoteTemplate doubleEighthTempl, NoteTemplate quarterTempl, Binarization method, bool bank, string sinkPath);
+RecognitionCache createRecognitionCache(Mat sheet, NoteTemplate doubleEighthTempl, NoteTemplate quarterTempl, Binarization method = BINARIZE_GAUSSIAN);
+vector<Rect> updateRecognition(RecognitionCache &cache, Mat sheet);
+SheetConfig defaultSheetConfig();
+Mat renderNoteTemplate(SheetConfig config, GlyphType type);
+Mat renderSheet(SheetConfig config, RNG &rng, vector<GroundTruthNote> &truth);
+bool saveGroundTruth(string path, vector<GroundTruthNote> truth);
+vector<GroundTruthNote> loadGroundTruth(string path);
+
+// Reusable buffers for the intermediate images, one workspace per thread
+Mat acquireWorkspaceBuffer(Size size, int type);
+void releaseWorkspace();
+int workspaceAllocationCount();
+void resetWorkspaceAllocationCount();
+
+// Allocation counting, only linked in the benchmark executable
+void installAllocationCounter();
+void resetAllocationCounters();
+int heapAllocationCount();
+int matAllocationCount();
 
 #endif //NOTES_H
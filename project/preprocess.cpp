@@ -0,0 +1,113 @@
+/*
+ * @title Labo beeldinterpretatie 2018: project
+ * @author Dylan Van Assche
+ *
+ * ---> BASIC MUSIC NOTES RECOGNITION <---
+ *
+ * This Proof-Of-Concept (POC) can extract the music notes from a music sheet and save the sound of them into a
+ * WAV audio file.
+ *
+ * Features:
+ *  - Detect non-rotated 1/4 and 1/16 notes using template matching.
+ *  - Find the tone height of each note using the staff lines extraction and vertical histograms.
+ *  - Merge both into a music tone and save it to a WAV audio file using a WAV library.
+ *
+ * Usage:
+ *  - cmake CMakeLists.txt
+ *  - make
+ *  - ./project --sheet=musicSheet.png --output=output.wav --quarter-note=quarter-note.png \
+ *    --double-eighth-note=double-eighth-note.png
+ *
+ */
+#include "notes.h"
+
+/*
+ * Removes noise, inverts and thresholds tiles of the input image. Each tile is copied together with PREPROCESS_HALO
+ * extra pixels on every side into a small buffer and streamed through all the steps while it's still in the L2 cache.
+ * The opening (ERODE_DILATE_ITER erosions + dilations) and the THRESHOLD_BLOCK_SIZE threshold window can only look that
+ * far, so the halo absorbs the tile borders and the core of each tile is identical to processing the complete image.
+ *
+ * The buffers come from the workspace of the thread running the tiles and are reused for every tile and sheet of the
+ * same size, only the core of each tile is written back to the output image in memory.
+ *
+ * @author Dylan Van Assche
+ */
+class PreprocessTiles : public ParallelLoopBody {
+public:
+    PreprocessTiles(const Mat &input, Mat &output, int tilesPerRow, Binarization method)
+            : input(input), output(output), tilesPerRow(tilesPerRow), method(method) {}
+
+    virtual void operator()(const Range &range) const {
+        for(int t = range.start; t < range.end; ++t) {
+            Rect core(
+                    (t % tilesPerRow) * PREPROCESS_TILE_SIZE,
+                    (t / tilesPerRow) * PREPROCESS_TILE_SIZE,
+                    PREPROCESS_TILE_SIZE,
+                    PREPROCESS_TILE_SIZE
+            );
+            core &= Rect(0, 0, input.cols, input.rows);
+            Rect halo = Rect(
+                    Point(core.x - PREPROCESS_HALO, core.y - PREPROCESS_HALO),
+                    Point(core.x + core.width + PREPROCESS_HALO, core.y + core.height + PREPROCESS_HALO)
+            ) & Rect(0, 0, input.cols, input.rows);
+
+            // Own copy of the tile: borders are handled as image borders, the input isn't modified
+            Mat tile = acquireWorkspaceBuffer(halo.size(), input.type());
+            Mat thresholded = acquireWorkspaceBuffer(halo.size(), input.type());
+            input(halo).copyTo(tile);
+
+            // Opening, see splitStaffLinesAndNotes()
+            erode(tile, tile, Mat(), Point(-1, -1), ERODE_DILATE_ITER);
+            dilate(tile, tile, Mat(), Point(-1, -1), ERODE_DILATE_ITER);
+
+            // Invert + adaptive threshold, see splitStaffLinesAndNotes(). Not in place: the mean is stored in the output.
+            bitwise_not(tile, tile);
+            binarizeSheet(tile, thresholded, method);
+
+            // Only the core is valid, the halo is handled by the neighbouring tiles
+            thresholded(Rect(core.x - halo.x, core.y - halo.y, core.width, core.height)).copyTo(output(core));
+        }
+    }
+
+private:
+    const Mat &input;
+    Mat &output;
+    int tilesPerRow;
+    Binarization method;
+};
+
+/*
+ * Fused preprocessing kernel: opening, inversion and adaptive threshold in a single cache-blocked pass. The image is
+ * cut in tiles of PREPROCESS_TILE_SIZE x PREPROCESS_TILE_SIZE pixels which are distributed over all cores. Instead of
+ * 4 full passes over the image with their own temporaries, every pixel is read and written once from memory.
+ *
+ * @param Mat input
+ * @param Mat binary
+ * @param Binarization method
+ * @author Dylan Van Assche
+ */
+void preprocessSheet(Mat input, Mat &binary, Binarization method) {
+    binary.create(input.size(), input.type());
+
+    int tilesPerRow = (input.cols + PREPROCESS_TILE_SIZE - 1) / PREPROCESS_TILE_SIZE;
+    int tilesPerCol = (input.rows + PREPROCESS_TILE_SIZE - 1) / PREPROCESS_TILE_SIZE;
+
+    // Range of tiles, nstripes = number of threads to keep the tiles of each thread consecutive
+    parallel_for_(Range(0, tilesPerRow * tilesPerCol), PreprocessTiles(input, binary, tilesPerRow, method), getNumThreads());
+}
+
+/*
+ * Reference preprocessing chain, each step is a full pass over the image. Kept to validate and benchmark
+ * preprocessSheet() against.
+ *
+ * @param Mat input
+ * @param Mat binary
+ * @author Dylan Van Assche
+ */
+void preprocessSheetReference(Mat input, Mat &binary) {
+    binary = input.clone(); // Make sure we don't modify the input
+    erode(binary, binary, Mat(), Point(-1, -1), ERODE_DILATE_ITER);
+    dilate(binary, binary, Mat(), Point(-1, -1), ERODE_DILATE_ITER);
+    binary = ~binary;
+    adaptiveThreshold(binary, binary, THRESHOLD_MAX, ADAPTIVE_THRESH_GAUSSIAN_C, THRESH_BINARY, THRESHOLD_BLOCK_SIZE, THRESHOLD_C);
+}
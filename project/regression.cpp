@@ -0,0 +1,417 @@
+/*
+ * @title Labo beeldinterpretatie 2018: project
+ * @author Dylan Van Assche
+ *
+ * ---> BASIC MUSIC NOTES RECOGNITION: REGRESSION <---
+ *
+ * Runs the music notes recognition over a corpus of sheets with ground truth notes and compares the accuracy and the
+ * speed with a baseline. Performance patches can't silently lose recognition quality this way.
+ *
+ * Corpus (see generator.cpp):
+ *  - sheet_*.png: the music sheets, each with a sheet_*.csv file with its ground truth notes.
+ *  - quarter-note.png and double-eighth-note.png: the templates of the notes.
+ *
+ * For each sheet:
+ *  - Precision and recall of the pitch and the duration. A detected note matches the nearest unmatched ground truth
+ *    note whose box contains its position and row, it's correct if the frequency or length is the same.
+ *  - Staff systems: each system is recognized separately (see recognizeNotes()), all systems of the ground truth must
+ *    be found.
+ *  - Wall time: the fastest of a number of runs, to filter out noise of other processes.
+ *  - Peak RSS: the highest resident memory of the process during the runs of the sheet (Linux only, -1 otherwise).
+ *
+ * The results are written as CSV to stdout. The run fails (return code -4) when the accuracy of a sheet drops more
+ * than --max-accuracy-drop below the baseline, when staff systems of a sheet are missed or when the total wall time
+ * increases more than --max-time-increase.
+ *
+ * Usage:
+ *  - cmake CMakeLists.txt
+ *  - make
+ *  - ./generator --output=corpus --count=20 --systems=3 --height-mm=120 --noise=10
+ *  - ./regression --corpus=corpus --baseline=corpus/baseline.csv --update-baseline
+ *  - ./regression --corpus=corpus --baseline=corpus/baseline.csv
+ *
+ */
+#include "notes.h"
+
+#define FREQUENCY_TOLERANCE 1.0 // Hz
+#define LENGTH_TOLERANCE 1.0 // samples
+#define BASELINE_HEADER "sheet,notes,detections,pitch_precision,pitch_recall,duration_precision,duration_recall,wall_ms,peak_rss_kb"
+
+typedef struct SheetResult {
+    string sheet;
+    int notes;
+    int detections;
+    double pitchPrecision;
+    double pitchRecall;
+    double durationPrecision;
+    double durationRecall;
+    double wallMs;
+    long peakRssKb;
+} SheetResult;
+
+/*
+ * Resets the peak resident memory of the process (Linux >= 4.0). The next peakResidentMemory() call returns the
+ * highest resident memory since this call.
+ *
+ * @author Dylan Van Assche
+ */
+void resetPeakResidentMemory() {
+    ofstream clearRefs("/proc/self/clear_refs");
+    clearRefs << "5" << endl;
+}
+
+/*
+ * Reads the peak resident memory of the process.
+ *
+ * @returns long peak resident memory in kB, -1 if unknown
+ * @author Dylan Van Assche
+ */
+long peakResidentMemory() {
+    ifstream status("/proc/self/status");
+    string row;
+    long peak = -1;
+
+    while(getline(status, row)) {
+        if(sscanf(row.c_str(), "VmHWM: %ld kB", &peak) == 1) {
+            break;
+        }
+    }
+
+    return peak;
+}
+
+/*
+ * Recognizes the notes on a sheet, the same steps as main.cpp without displaying anything: every staff system is
+ * recognized separately and placed on the timeline of the sheet.
+ *
+ * @param Mat sheet
+ * @param NoteTemplate doubleEighthTempl, inverted
+ * @param NoteTemplate quarterTempl, inverted
+ * @param Binarization binarization
+ * @param bool bank: detect notes with the template banks instead of the upright templates
+ * @param int systems, number of staff systems found on the sheet
+ * @returns Timeline timeline, rows of the notes relative to the sheet
+ * @author Dylan Van Assche
+ */
+Timeline recognizeNotes(Mat sheet, NoteTemplate doubleEighthTempl, NoteTemplate quarterTempl, Binarization binarization, bool bank, int &systems) {
+    Timeline timeline;
+    timeline.length = 0;
+    vector<Rect> found = findStaffSystems(sheet);
+    systems = found.size();
+    vector<Rect> staffSystems = staffSystemsOrSheet(sheet, found);
+
+    for(int s=0; s < staffSystems.size(); ++s) {
+        Rect system = staffSystems.at(s);
+        NoteSheet noteSheet = splitStaffLinesAndNotes(sheet(system), binarization);
+        ContoursData contoursDoubleEight, contoursQuarter;
+        if(bank) {
+            contoursDoubleEight = getContoursDataFromBank(noteSheet.notes, createTemplateBank(doubleEighthTempl));
+            contoursQuarter = getContoursDataFromBank(contoursDoubleEight.image, createTemplateBank(quarterTempl));
+        }
+        else {
+            contoursDoubleEight = getContoursData(noteSheet.notes, doubleEighthTempl);
+            contoursQuarter = getContoursData(contoursDoubleEight.image, quarterTempl);
+        }
+        vector<StaffLineData> distances = getStaffLineDistances(noteSheet.staffLines);
+
+        // Without enough staff lines, convertDataToNote() finds no notes and the system scores 0
+        vector<ContoursData> data;
+        data.push_back(contoursDoubleEight);
+        data.push_back(contoursQuarter);
+        vector<Note> notes = convertDataToNote(noteSheet.notes, data, distances, system.height, system.width);
+        appendTimeline(timeline, buildTimeline(noteSheet.notes, notes, distances), s, system.y);
+    }
+
+    return timeline;
+}
+
+/*
+ * Matches the detected notes with the ground truth and computes the precision and recall of the pitch and duration.
+ *
+ * @param vector<TimedNote> detected
+ * @param vector<GroundTruthNote> truth
+ * @param SheetResult result
+ * @author Dylan Van Assche
+ */
+void scoreNotes(vector<TimedNote> detected, vector<GroundTruthNote> truth, SheetResult &result) {
+    vector<bool> matched(truth.size(), false);
+    int correctPitch = 0;
+    int correctDuration = 0;
+
+    for(int d=0; d < detected.size(); ++d) {
+        // Nearest unmatched ground truth note containing the detection, the row keeps the systems apart
+        Note note = detected.at(d).note;
+        int best = -1;
+        double bestDistance = 0;
+        for(int t=0; t < truth.size(); ++t) {
+            Rect box = truth.at(t).box;
+            if(matched.at(t) || note.position < box.x || note.position >= box.x + box.width
+               || note.row < box.y || note.row >= box.y + box.height) {
+                continue;
+            }
+
+            double distance = fabs(note.position - (box.x + box.width / 2.0));
+            if(best < 0 || distance < bestDistance) {
+                best = t;
+                bestDistance = distance;
+            }
+        }
+
+        if(best < 0) {
+            continue;
+        }
+
+        matched.at(best) = true;
+        if(fabs(note.frequency - truth.at(best).frequency) < FREQUENCY_TOLERANCE) {
+            ++correctPitch;
+        }
+        if(fabs(note.length - truth.at(best).length) < LENGTH_TOLERANCE) {
+            ++correctDuration;
+        }
+    }
+
+    // An empty sheet without detections is perfect
+    result.notes = truth.size();
+    result.detections = detected.size();
+    result.pitchPrecision = detected.empty() ? (truth.empty() ? 1.0 : 0.0) : (double) correctPitch / detected.size();
+    result.pitchRecall = truth.empty() ? 1.0 : (double) correctPitch / truth.size();
+    result.durationPrecision = detected.empty() ? (truth.empty() ? 1.0 : 0.0) : (double) correctDuration / detected.size();
+    result.durationRecall = truth.empty() ? 1.0 : (double) correctDuration / truth.size();
+}
+
+/*
+ * Writes a result as a CSV line in the baseline format.
+ *
+ * @param ostream output
+ * @param SheetResult result
+ * @author Dylan Van Assche
+ */
+void writeResult(ostream &output, SheetResult result) {
+    output << result.sheet << ","
+           << result.notes << ","
+           << result.detections << ","
+           << result.pitchPrecision << ","
+           << result.pitchRecall << ","
+           << result.durationPrecision << ","
+           << result.durationRecall << ","
+           << result.wallMs << ","
+           << result.peakRssKb << endl;
+}
+
+/*
+ * Loads a baseline written by --update-baseline.
+ *
+ * @param string path
+ * @returns map<string, SheetResult> results by sheet name, empty if the file can't be read
+ * @author Dylan Van Assche
+ */
+map<string, SheetResult> loadBaseline(string path) {
+    map<string, SheetResult> baseline;
+    ifstream file(path.c_str());
+    string row;
+
+    // Skip header
+    getline(file, row);
+    while(getline(file, row)) {
+        SheetResult result;
+        char sheet[256];
+        if(sscanf(row.c_str(), "%255[^,],%d,%d,%lf,%lf,%lf,%lf,%lf,%ld", sheet, &result.notes, &result.detections,
+                  &result.pitchPrecision, &result.pitchRecall, &result.durationPrecision, &result.durationRecall,
+                  &result.wallMs, &result.peakRssKb) == 9) {
+            result.sheet = sheet;
+            baseline[result.sheet] = result;
+        }
+    }
+
+    return baseline;
+}
+
+/*
+ * Checks if an accuracy metric dropped too much compared with the baseline and reports it.
+ *
+ * @param string sheet
+ * @param string metric
+ * @param double value
+ * @param double baselineValue
+ * @param double maxDrop
+ * @returns bool true if the metric regressed
+ * @author Dylan Van Assche
+ */
+bool accuracyRegressed(string sheet, string metric, double value, double baselineValue, double maxDrop) {
+    if(value < baselineValue - maxDrop) {
+        cerr << sheet << ": " << metric << " dropped from " << baselineValue << " to " << value << endl;
+        return true;
+    }
+
+    return false;
+}
+
+int main(int argc, const char** argv) {
+    CommandLineParser parser(argc, argv,
+                 "{ help h usage ?     |          | Shows this message.                                        }"
+                 "{ corpus c           |          | Directory with the sheets and templates <REQUIRED>         }"
+                 "{ baseline           |          | Baseline CSV file to compare with <REQUIRED>               }"
+                 "{ update-baseline    |          | Writes the results to the baseline instead of comparing    }"
+                 "{ iterations i       | 3        | Number of runs per sheet, the fastest is recorded          }"
+                 "{ max-accuracy-drop  | 0.01     | Allowed drop of a precision or recall [0, 1]               }"
+                 "{ max-time-increase  | 0.25     | Allowed relative increase of the total wall time           }"
+                 "{ binarization b     | gaussian | Adaptive threshold: gaussian, mean or sauvola              }"
+                 "{ detection d        | template | Note detection: template or bank                           }"
+    );
+
+    // Help printing
+    if(parser.has("help") || argc <= 1) {
+        parser.printMessage();
+        return 0;
+    }
+
+    // Parser fail
+    if (!parser.check()) {
+        parser.printErrors();
+        return -1;
+    }
+
+    // Required arguments supplied?
+    string corpus(parser.get<string>("corpus"));
+    string baselinePath(parser.get<string>("baseline"));
+    bool updateBaseline = parser.has("update-baseline");
+    int iterations = parser.get<int>("iterations");
+    double maxAccuracyDrop = parser.get<double>("max-accuracy-drop");
+    double maxTimeIncrease = parser.get<double>("max-time-increase");
+    if(corpus.empty() || baselinePath.empty() || iterations <= 0 || maxAccuracyDrop < 0 || maxTimeIncrease < 0) {
+        cerr << "Please supply your parameters using command line arguments: "
+        << "--corpus=corpus "
+        << "--baseline=corpus/baseline.csv "
+        << "--iterations=3"
+        << endl;
+        return -2;
+    }
+
+    int binarization = binarizationFromName(parser.get<string>("binarization"));
+    if(binarization < 0) {
+        cerr << "Unknown binarization method, please use: --binarization=gaussian|mean|sauvola" << endl;
+        return -2;
+    }
+
+    string detection(parser.get<string>("detection"));
+    if(detection != "bank" && detection != "template") {
+        cerr << "Unknown note detection, please use: --detection=template|bank" << endl;
+        return -2;
+    }
+
+    // Try to load the corpus
+    vector<String> sheets;
+    glob(corpus + "/sheet_*.png", sheets, false);
+    sort(sheets.begin(), sheets.end());
+    Mat quarterImg = imread(corpus + "/quarter-note.png", IMREAD_GRAYSCALE);
+    Mat doubleEighthImg = imread(corpus + "/double-eighth-note.png", IMREAD_GRAYSCALE);
+    map<string, SheetResult> baseline;
+    if(!updateBaseline) {
+        baseline = loadBaseline(baselinePath);
+    }
+
+    if(sheets.empty() || quarterImg.empty() || doubleEighthImg.empty() || (!updateBaseline && baseline.empty())) {
+        cerr << "Loading the corpus failed, please verify the paths to the corpus and the baseline." << endl;
+        return -3;
+    }
+
+    // Associate the length of the note with each template, inverted like the notes image
+    NoteTemplate doubleEighthTempl;
+    doubleEighthTempl.templ = ~doubleEighthImg;
+    doubleEighthTempl.length = NOTE_LENGTH_16;
+    NoteTemplate quarterTempl;
+    quarterTempl.templ = ~quarterImg;
+    quarterTempl.length = NOTE_LENGTH_4;
+
+    // Headless
+    displayResults = false;
+    bool regressed = false;
+    double totalMs = 0;
+    double baselineTotalMs = 0;
+    vector<SheetResult> results;
+
+    cout << BASELINE_HEADER << endl;
+    for(int s=0; s < sheets.size(); ++s) {
+        string sheetPath(sheets.at(s));
+        string truthPath = sheetPath.substr(0, sheetPath.size() - 4) + ".csv";
+        Mat sheetImg = imread(sheetPath, IMREAD_GRAYSCALE);
+        vector<GroundTruthNote> truth = loadGroundTruth(truthPath);
+        if(sheetImg.empty()) {
+            cerr << "Loading images failed, please verify the paths to the images." << endl;
+            return -3;
+        }
+
+        SheetResult result;
+        result.sheet = sheetPath.substr(sheetPath.find_last_of("/\\") + 1);
+        result.wallMs = -1;
+        Timeline detected;
+        int systems = 0;
+
+        resetPeakResidentMemory();
+        for(int i=0; i < iterations; ++i) {
+            int64 start = getTickCount();
+            detected = recognizeNotes(sheetImg, doubleEighthTempl, quarterTempl, (Binarization) binarization, detection == "bank", systems);
+            double ms = (getTickCount() - start) * 1000.0 / getTickFrequency();
+            if(result.wallMs < 0 || ms < result.wallMs) {
+                result.wallMs = ms;
+            }
+        }
+        result.peakRssKb = peakResidentMemory();
+        scoreNotes(detected.notes, truth, result);
+        writeResult(cout, result);
+        results.push_back(result);
+
+        // Every system with notes must be found, otherwise the notes of the missing systems are mixed with others
+        int truthSystems = 0;
+        for(int t=0; t < truth.size(); ++t) {
+            truthSystems = max(truthSystems, truth.at(t).system + 1);
+        }
+        if(systems < truthSystems) {
+            cerr << result.sheet << ": " << systems << " of " << truthSystems << " staff systems found" << endl;
+            regressed = true;
+        }
+
+        // Compare with the baseline
+        if(!updateBaseline) {
+            map<string, SheetResult>::iterator it = baseline.find(result.sheet);
+            if(it == baseline.end()) {
+                cerr << result.sheet << ": not in the baseline" << endl;
+                continue;
+            }
+
+            SheetResult reference = it->second;
+            regressed |= accuracyRegressed(result.sheet, "pitch precision", result.pitchPrecision, reference.pitchPrecision, maxAccuracyDrop);
+            regressed |= accuracyRegressed(result.sheet, "pitch recall", result.pitchRecall, reference.pitchRecall, maxAccuracyDrop);
+            regressed |= accuracyRegressed(result.sheet, "duration precision", result.durationPrecision, reference.durationPrecision, maxAccuracyDrop);
+            regressed |= accuracyRegressed(result.sheet, "duration recall", result.durationRecall, reference.durationRecall, maxAccuracyDrop);
+            totalMs += result.wallMs;
+            baselineTotalMs += reference.wallMs;
+        }
+    }
+
+    if(updateBaseline) {
+        ofstream file(baselinePath.c_str());
+        file << BASELINE_HEADER << endl;
+        for(int r=0; r < results.size(); ++r) {
+            writeResult(file, results.at(r));
+        }
+        if(!file.good()) {
+            cerr << "Writing the baseline failed." << endl;
+            return -3;
+        }
+        return 0;
+    }
+
+    // The time of a single sheet is too noisy, the total of the sheets in the baseline is compared
+    if(totalMs > baselineTotalMs * (1.0 + maxTimeIncrease)) {
+        cerr << "Total wall time increased from " << baselineTotalMs << " ms to " << totalMs << " ms" << endl;
+        regressed = true;
+    }
+
+    if(regressed) {
+        cerr << "Regression detected!" << endl;
+        return -4;
+    }
+
+    return 0;
+}
@@ -0,0 +1,57 @@
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <opencv2/opencv.hpp>
+
+/*
+ * Lock-free ring buffer for exactly one producer thread and one consumer thread. The producer only writes the tail,
+ * the consumer only writes the head. Both indices are updated with an atomic add (CV_XADD, full memory barrier) after
+ * the item is written or read, so the other thread never sees an index before the item it publishes. The index of the
+ * other thread is only read: a volatile read followed by a memory barrier, so the item isn't read before its index.
+ *
+ * The indices only grow, CAPACITY must be a power of 2 so they stay correct modulo CAPACITY.
+ *
+ * @author Dylan Van Assche
+ */
+template<typename T, int CAPACITY>
+class RingBuffer {
+public:
+    RingBuffer() : head(0), tail(0) {}
+
+    // Producer: returns false if the buffer is full
+    bool push(const T &item) {
+        if(tail - load(head) == CAPACITY) {
+            return false;
+        }
+
+        items[tail & (CAPACITY - 1)] = item;
+        CV_XADD(&tail, 1);
+        return true;
+    }
+
+    // Consumer: returns false if the buffer is empty
+    bool pop(T &item) {
+        if(load(tail) == head) {
+            return false;
+        }
+
+        item = items[head & (CAPACITY - 1)];
+        CV_XADD(&head, 1);
+        return true;
+    }
+
+private:
+    // Read of an index written by the other thread, an aligned int is read at once
+    static int load(const int &index) {
+        int value = *(const volatile int *) &index;
+        __sync_synchronize();
+        return value;
+    }
+
+    T items[CAPACITY];
+    int head;
+    char padding[64]; // head and tail in different cache lines
+    int tail;
+};
+
+#endif //RINGBUFFER_H
@@ -69,6 +69,58 @@ void saveWaveforms(string outputPath, vector< vector<short> > waveforms) {
     // Close the WAV file
     wavfile_close(f);
 
-    cout << "Saved WAV file as '" << outputPath << "'" << endl;
+    if(displayResults) {
+        cout << "Saved WAV file as '" << outputPath << "'" << endl;
+    }
+}
+
+/*
+ * Adds a sine wave with a given frequency and length to a waveform, starting at an onset. Notes which sound at the same
+ * time are summed, the sum is clipped to the range of a short. The waveform isn't resized: samples past its end are
+ * dropped.
+ *
+ * @param vector<short> output
+ * @param int onset
+ * @param double frequency
+ * @param int length
+ * @author Dylan Van Assche
+ */
+void mixWaveform(vector<short> &output, int onset, double frequency, int length) {
+    int end = min(onset + length, (int) output.size());
+
+    for(int i=max(onset, 0); i < end; i++) {
+        double t = (double) (i - onset) / WAVFILE_SAMPLES_PER_SECOND;
+        int sample = output.at(i) + (int) (VOLUME * sin(2 * M_PI * frequency * t));
+        output.at(i) = (short) max(SHRT_MIN, min(SHRT_MAX, sample));
+    }
 }
 
+/*
+ * Writes a single waveform to a WAV file using the WAVFile C library, without copying it.
+ * If the file can't be opened, this function returns and writes an error message to the console.
+ *
+ * @param string outputPath
+ * @param vector<short> waveform
+ * @author Dylan Van Assche
+ */
+void saveWaveform(string outputPath, const vector<short> &waveform) {
+    // Open WAV file
+    FILE* f = wavfile_open(outputPath.c_str());
+    if(!f)
+    {
+        cerr << "Opening sound file failed!" << endl;
+        return;
+    }
+
+    // wavfile_write() doesn't modify the samples
+    if(!waveform.empty()) {
+        wavfile_write(f, const_cast<short*>(&waveform[0]), (int) waveform.size());
+    }
+
+    // Close the WAV file
+    wavfile_close(f);
+
+    if(displayResults) {
+        cout << "Saved WAV file as '" << outputPath << "'" << endl;
+    }
+}
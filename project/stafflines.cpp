@@ -21,6 +21,9 @@
  */
 #include "notes.h"
 
+// Show intermediate results in windows and print them to the console, disabled for headless runs (benchmark, ...)
+bool displayResults = true;
+
 // std::sort helper function
 bool sortStaffLinesBiggestValueFirst(const StaffLineData &a, const StaffLineData &b) {
     return a.value > b.value; // biggest first
@@ -76,6 +79,40 @@ void drawHistogram(Mat histogram, int rows, int cols) {
     waitKey(0);
 }
 
+/*
+ * Runs the horizontal (branch 0) and vertical (branch 1) lines extraction concurrently. Both branches read the same
+ * binary image and write into their own output buffer which is allocated before the branches start.
+ *
+ * @author Dylan Van Assche
+ */
+class LineExtractionBranches : public ParallelLoopBody {
+public:
+    LineExtractionBranches(const Mat &binary, Mat &horizontalLines, Mat &verticalLines, Mat horizontalStructure, Mat verticalStructure)
+            : binary(binary), horizontalLines(horizontalLines), verticalLines(verticalLines),
+              horizontalStructure(horizontalStructure), verticalStructure(verticalStructure) {}
+
+    virtual void operator()(const Range &range) const {
+        for(int b = range.start; b < range.end; ++b) {
+            // Apply morphology operations on both, anchor = element center (Point(-1, -1))
+            if(b == 0) {
+                erode(binary, horizontalLines, horizontalStructure, Point(-1, -1));
+                dilate(horizontalLines, horizontalLines, horizontalStructure, Point(-1, -1));
+            }
+            else {
+                erode(binary, verticalLines, verticalStructure, Point(-1, -1));
+                dilate(verticalLines, verticalLines, verticalStructure, Point(-1, -1));
+            }
+        }
+    }
+
+private:
+    const Mat &binary;
+    Mat &horizontalLines;
+    Mat &verticalLines;
+    Mat horizontalStructure;
+    Mat verticalStructure;
+};
+
 /*
  * By applying erosion (remove noise) and dilation (connect blobs) using a structure element, we can extract the
  * vertical and horizontal lines of the staff lines.
@@ -88,12 +125,17 @@ void drawHistogram(Mat histogram, int rows, int cols) {
  * the histogram are staff lines. However, the morfologic approach is a bit more robust in this case due the use of a
  * specific kernel (a difference of a couple of pixels are ignored).
  *
+ * To reduce the latency of a single sheet, the preprocessing is split into tiles over all cores and both lines
+ * extractions run at the same time. All images come from the workspace, the returned NoteSheet keeps its buffers in
+ * use until the caller releases it.
+ *
  * @param Mat input
+ * @param Binarization method
  * @returns NoteSheet sheet
  * @author Dylan Van Assche
  */
-NoteSheet splitStaffLinesAndNotes(Mat input) {
-    Mat binary = input.clone(); // Make sure we don't modify the input
+NoteSheet splitStaffLinesAndNotes(Mat input, Binarization method) {
+    Mat binary = acquireWorkspaceBuffer(input.size(), input.type()); // Make sure we don't modify the input
     NoteSheet result;
 
     /*
@@ -101,30 +143,22 @@ NoteSheet splitStaffLinesAndNotes(Mat input) {
      * input, output, kernel, anchor point, iterations
      * kernel = structuring element form
      * anchor = anchor of the structuring element, Point(-1, -1) = center
-     */
-    erode(binary, binary, 0, Point(-1, -1), ERODE_DILATE_ITER);
-    dilate(binary, binary, 0, Point(-1, -1), ERODE_DILATE_ITER);
-
-    /*
+     *
      * Threshold the gray image to a binary image using adaptive threshold (better resistance against different light
      * conditions). We invert the image before applying the threshold since we want a black background and white notes.
      *
      * ADAPTIVE_THRESH_GAUSSIAN_C seems to improve the extraction a little bit, the alternative ADAPTIVE_THRESH_MEAN_C
-     * uses the same weight for all neighbors.
+     * uses the same weight for all neighbors. For high DPI sheets with bigger block sizes, the integral image methods
+     * BINARIZE_MEAN and BINARIZE_SAUVOLA have a constant cost per pixel (see binarizeSheet()).
      *
      * THRESHOLD_BLOCK_SIZE set to 15 is a good window size for music notes.
      * THRESHOLD_C set to -2, constant subtracted from the mean or weighted mean.
      *
      * https://docs.opencv.org/3.2.0/d7/d1b/group__imgproc__misc.html#ga72b913f352e4a1b1b397736707afcde3
      *
-     * Input, output, maximum threshold value, mode, threshold type, block size, constant for subtraction
+     * Both steps are fused into a single cache-blocked pass over the image (see preprocessSheet()).
      */
-    binary = ~binary; // Invert image
-    adaptiveThreshold(binary, binary, THRESHOLD_MAX, ADAPTIVE_THRESH_GAUSSIAN_C, THRESH_BINARY, THRESHOLD_BLOCK_SIZE, THRESHOLD_C);
-
-    // Clone binary image for horizontal and vertical lines extraction
-    Mat horizontalLines = binary.clone();
-    Mat verticalLines = binary.clone();
+    preprocessSheet(input, binary, method);
 
     /*
      * Generate the structure elements for these lines.
@@ -140,22 +174,24 @@ NoteSheet splitStaffLinesAndNotes(Mat input) {
      *  https://docs.opencv.org/master/d4/d86/group__imgproc__filter.html#gaeb1e0c1033e3f6b891a25d0511362aeb
      */
 
-    // Generate structure element
-    int horizontalSize = horizontalLines.cols / HORIZONTAL_DIVIDER;
-    int verticalSize = verticalLines.rows / VERTICAL_DIVIDER;
-    // type, Size of structure element
-    Mat horizontalStructure = getStructuringElement(MORPH_RECT, Size(horizontalSize, HORIZONTAL_HEIGHT));
-    Mat verticalStructure = getStructuringElement(MORPH_RECT, Size(VERTICAL_WIDTH, verticalSize));
+    // Generate structure element, a MORPH_RECT element is filled with ones (see getStructuringElement())
+    int horizontalSize = binary.cols / HORIZONTAL_DIVIDER;
+    int verticalSize = binary.rows / VERTICAL_DIVIDER;
+    Mat horizontalStructure = acquireWorkspaceBuffer(Size(horizontalSize, HORIZONTAL_HEIGHT), CV_8UC1);
+    Mat verticalStructure = acquireWorkspaceBuffer(Size(VERTICAL_WIDTH, verticalSize), CV_8UC1);
+    horizontalStructure.setTo(Scalar::all(1));
+    verticalStructure.setTo(Scalar::all(1));
 
-    // Apply morphology operations on both, anchor = element center (Point(-1, -1))
-    erode(horizontalLines, horizontalLines, horizontalStructure, Point(-1, -1));
-    dilate(horizontalLines, horizontalLines, horizontalStructure, Point(-1, -1));
-    erode(verticalLines, verticalLines, verticalStructure, Point(-1, -1));
-    dilate(verticalLines, verticalLines, verticalStructure, Point(-1, -1));
+    // Pre-allocate the output of both branches and extract horizontal and vertical lines concurrently
+    Mat horizontalLines = acquireWorkspaceBuffer(binary.size(), binary.type());
+    Mat verticalLines = acquireWorkspaceBuffer(binary.size(), binary.type());
+    parallel_for_(Range(0, NUMBER_OF_LINE_BRANCHES),
+                  LineExtractionBranches(binary, horizontalLines, verticalLines, horizontalStructure, verticalStructure));
 
     // Push the results into a NoteSheet struct
     result.staffLines = horizontalLines;
     result.notes = verticalLines;
+    result.binary = binary;
 
     return result;
 }
@@ -175,11 +211,10 @@ NoteSheet splitStaffLinesAndNotes(Mat input) {
  * value like the staff lines.
  *
  * @param Mat input
- * @returns vector<int> distances
+ * @returns vector<int> distances, at most NUMBER_OF_STAFF_LINES
  * @author Dylan Van Assche
  */
 vector<StaffLineData> getStaffLineDistances(Mat input) {
-    Mat img = input.clone();
     vector<StaffLineData> distances;
     vector<StaffLineData> distancesFiltered;
 
@@ -190,9 +225,11 @@ vector<StaffLineData> getStaffLineDistances(Mat input) {
      *
      * Mat input, Mat output, dimension (0 = single row, 1 = single column)
      */
-    Mat verticalHistogram;
-    reduce(img, verticalHistogram, REDUCE_DIMENSION, CV_REDUCE_SUM, CV_32S);
-    drawHistogram(verticalHistogram, input.rows, input.rows);
+    Mat verticalHistogram = acquireWorkspaceBuffer(Size(1, input.rows), CV_32SC1);
+    reduce(input, verticalHistogram, REDUCE_DIMENSION, CV_REDUCE_SUM, CV_32S);
+    if(displayResults) {
+        drawHistogram(verticalHistogram, input.rows, input.rows);
+    }
 
     /*
      * Finds the local maxima in the histogram.
@@ -224,9 +261,11 @@ vector<StaffLineData> getStaffLineDistances(Mat input) {
         previousVal = currentVal;
     }
 
-    // Only the 5 biggest results are staff lines, sort them from BIG to SMALL
+    // Only the 5 biggest results are staff lines, sort them from BIG to SMALL. A sheet without 5 peaks (blank or
+    // cropped sheet) returns the peaks it has, the caller checks if they are enough.
     sort(distances.begin(), distances.end(), sortStaffLinesBiggestValueFirst);
-    for(int s=0; s < NUMBER_OF_STAFF_LINES; ++s) {
+    int numberOfLines = min((int) distances.size(), NUMBER_OF_STAFF_LINES);
+    for(int s=0; s < numberOfLines; ++s) {
         distancesFiltered.push_back(distances.at(s));
     }
 
@@ -234,4 +273,79 @@ vector<StaffLineData> getStaffLineDistances(Mat input) {
     sort(distancesFiltered.begin(), distancesFiltered.end(), sortStaffLinesSmallestPositionFirst);
 
     return distancesFiltered;
-}
\ No newline at end of file
+}
+
+/*
+ * Finds the staff systems of a complete sheet, without the preprocessing: rows where at least STAFF_LINE_COVERAGE of
+ * the pixels are dark belong to a staff line, every NUMBER_OF_STAFF_LINES staff lines form a system. Each system is
+ * returned with its surroundings (notes above and below the staff) up to halfway the next system, or a staff height
+ * at the top and bottom of the sheet. These parts can be recognized separately like a sheet with a single system.
+ *
+ * @param Mat sheet
+ * @returns vector<Rect> systems, from top to bottom
+ * @author Dylan Van Assche
+ */
+vector<Rect> findStaffSystems(Mat sheet) {
+    vector<Rect> systems;
+    vector<int> lines;
+
+    // Number of dark pixels in each row, Mat input, Mat output, dimension (0 = single row, 1 = single column)
+    Mat horizontalHistogram;
+    reduce((sheet < DARK_PIXEL) / THRESHOLD_MAX, horizontalHistogram, REDUCE_DIMENSION, CV_REDUCE_SUM, CV_32S);
+
+    // Neighbouring rows belong to the same (thick) staff line, its center is kept
+    int minimum = cvCeil(STAFF_LINE_COVERAGE * sheet.cols);
+    int start = -1;
+    for(int y=0; y <= horizontalHistogram.rows; ++y) {
+        bool line = y < horizontalHistogram.rows && horizontalHistogram.at<int>(y, 0) >= minimum;
+        if(line && start < 0) {
+            start = y;
+        }
+        else if(!line && start >= 0) {
+            lines.push_back((start + y - 1) / 2);
+            start = -1;
+        }
+    }
+
+    // Staff of each system, incomplete systems are ignored
+    int numberOfSystems = lines.size() / NUMBER_OF_STAFF_LINES;
+    for(int s=0; s < numberOfSystems; ++s) {
+        int top = lines.at(s * NUMBER_OF_STAFF_LINES);
+        int bottom = lines.at((s + 1) * NUMBER_OF_STAFF_LINES - 1);
+        int height = bottom - top;
+
+        // Up to halfway the neighbouring systems
+        if(s > 0) {
+            top = (lines.at(s * NUMBER_OF_STAFF_LINES - 1) + top) / 2;
+        }
+        else {
+            top = max(0, top - height);
+        }
+        if(s < numberOfSystems - 1) {
+            bottom = (bottom + lines.at((s + 1) * NUMBER_OF_STAFF_LINES)) / 2;
+        }
+        else {
+            bottom = min(sheet.rows - 1, bottom + height);
+        }
+
+        systems.push_back(Rect(0, top, sheet.cols, bottom - top + 1));
+    }
+
+    return systems;
+}
+
+/*
+ * Parts of a sheet to recognize separately: the staff systems found by findStaffSystems() or, when the sheet has no
+ * complete system, the whole sheet. Shared by the WAV, stream and regression paths so they recognize the same parts.
+ *
+ * @param Mat sheet
+ * @param vector<Rect> systems, result of findStaffSystems()
+ * @returns vector<Rect> parts, from top to bottom
+ * @author Dylan Van Assche
+ */
+vector<Rect> staffSystemsOrSheet(Mat sheet, vector<Rect> systems) {
+    if(systems.empty()) {
+        systems.push_back(Rect(0, 0, sheet.cols, sheet.rows));
+    }
+    return systems;
+}
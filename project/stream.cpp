@@ -0,0 +1,217 @@
+/*
+ * @title Labo beeldinterpretatie 2018: project
+ * @author Dylan Van Assche
+ *
+ * ---> BASIC MUSIC NOTES RECOGNITION <---
+ *
+ * This Proof-Of-Concept (POC) can extract the music notes from a music sheet and save the sound of them into a
+ * WAV audio file.
+ *
+ * Features:
+ *  - Detect non-rotated 1/4 and 1/16 notes using template matching.
+ *  - Find the tone height of each note using the staff lines extraction and vertical histograms.
+ *  - Merge both into a music tone and save it to a WAV audio file using a WAV library.
+ *
+ * Usage:
+ *  - cmake CMakeLists.txt
+ *  - make
+ *  - ./project --sheet=musicSheet.png --output=output.wav --quarter-note=quarter-note.png \
+ *    --double-eighth-note=double-eighth-note.png
+ *
+ */
+#include <pthread.h>
+#include <unistd.h>
+#include "notes.h"
+#include "ringbuffer.h"
+
+typedef struct StreamState {
+    RingBuffer<TimedNote, STREAM_RING_CAPACITY> notes;
+    int finished; // set by the recognition after the last note
+    int length; // samples of the complete timeline, valid when finished
+    FILE *sink;
+    int64 start;
+    double firstSampleMs;
+} StreamState;
+
+/*
+ * Private function to write the samples [rendered, until) of the sounding notes to the sink in chunks of
+ * STREAM_CHUNK_SAMPLES samples. Notes which are completely written are removed.
+ *
+ * @param StreamState state
+ * @param vector<TimedNote> sounding
+ * @param vector<short> chunk
+ * @param int rendered, updated
+ * @param int until
+ * @author Dylan Van Assche
+ */
+void _streamUntil(StreamState *state, vector<TimedNote> &sounding, vector<short> &chunk, int &rendered, int until) {
+    while(rendered < until) {
+        int samples = min(STREAM_CHUNK_SAMPLES, until - rendered);
+        chunk.assign(samples, 0);
+
+        // Onsets relative to the chunk, mixWaveform() keeps the phase of notes spanning multiple chunks
+        for(int n=0; n < sounding.size(); ++n) {
+            mixWaveform(chunk, sounding.at(n).onset - rendered, sounding.at(n).note.frequency, sounding.at(n).length);
+        }
+
+        fwrite(&chunk[0], sizeof(short), samples, state->sink);
+        fflush(state->sink);
+        if(state->firstSampleMs < 0) {
+            state->firstSampleMs = (getTickCount() - state->start) * 1000.0 / getTickFrequency();
+        }
+        rendered += samples;
+
+        for(int n=sounding.size() - 1; n >= 0; --n) {
+            if(sounding.at(n).onset + sounding.at(n).length <= rendered) {
+                sounding.erase(sounding.begin() + n);
+            }
+        }
+    }
+}
+
+/*
+ * Synthesis thread: takes the notes from the ring buffer in the order of their onset and writes the samples before
+ * each onset to the sink. All notes starting earlier are already received, so the samples are final.
+ *
+ * @param void* StreamState
+ * @returns void* NULL
+ * @author Dylan Van Assche
+ */
+void *_synthesize(void *arg) {
+    StreamState *state = (StreamState *) arg;
+    vector<TimedNote> sounding;
+    vector<short> chunk;
+    int rendered = 0;
+
+    while(true) {
+        // Read before popping: everything is pushed before the recognition finishes
+        bool finished = CV_XADD(&state->finished, 0) != 0;
+        TimedNote timed;
+
+        if(state->notes.pop(timed)) {
+            _streamUntil(state, sounding, chunk, rendered, timed.onset);
+            sounding.push_back(timed);
+        }
+        else if(finished) {
+            break;
+        }
+        else {
+            usleep(STREAM_POLL_US);
+        }
+    }
+
+    // Remaining notes and the rest at the end of the last measure
+    int end = state->length;
+    for(int n=0; n < sounding.size(); ++n) {
+        end = max(end, sounding.at(n).onset + sounding.at(n).length);
+    }
+    _streamUntil(state, sounding, chunk, rendered, end);
+
+    return NULL;
+}
+
+/*
+ * Recognizes a sheet one staff system at a time and streams the sound while the next systems are recognized. The
+ * notes of each system are placed on a timeline (see buildTimeline()) and handed to a synthesis thread through a
+ * lock-free ring buffer. The synthesis thread writes raw PCM samples (signed 16 bit little endian, mono,
+ * WAVFILE_SAMPLES_PER_SECOND Hz) to a sink: stdout or a named pipe, for example:
+ *
+ *  mkfifo preview.pcm && aplay -f S16_LE -c 1 -r 44100 preview.pcm & ./project ... --stream=preview.pcm
+ *
+ * Each system is cut from the sheet with its surroundings (see findStaffSystems()) and recognized like a complete
+ * sheet, so the first note can be heard after recognizing the first system only. A sheet without complete systems is
+ * recognized as a whole, like the WAV output (see staffSystemsOrSheet()).
+ *
+ * @param Mat sheet
+ * @param NoteTemplate doubleEighthTempl, inverted
+ * @param NoteTemplate quarterTempl, inverted
+ * @param Binarization method
+ * @param bool bank: detect notes with the template banks instead of the upright templates
+ * @param string sinkPath, "-" for stdout
+ * @returns int 0 on success, -3 if the sink can't be opened
+ * @author Dylan Van Assche
+ */
+int streamSheet(Mat sheet, NoteTemplate doubleEighthTempl, NoteTemplate quarterTempl, Binarization method, bool bank, string sinkPath) {
+    // Allocated on the heap: the ring buffer is too big for the stack
+    StreamState *state = new StreamState();
+    state->finished = 0;
+    state->length = 0;
+    state->start = getTickCount();
+    state->firstSampleMs = -1;
+    state->sink = sinkPath == "-" ? stdout : fopen(sinkPath.c_str(), "wb");
+    if(!state->sink) {
+        cerr << "Opening the stream sink failed!" << endl;
+        delete state;
+        return -3;
+    }
+
+    pthread_t synthesis;
+    if(pthread_create(&synthesis, NULL, _synthesize, state) != 0) {
+        cerr << "Starting the synthesis thread failed!" << endl;
+        if(state->sink != stdout) {
+            fclose(state->sink);
+        }
+        delete state;
+        return -3;
+    }
+
+    vector<Rect> systems = staffSystemsOrSheet(sheet, findStaffSystems(sheet));
+    vector<NoteTemplate> doubleEighthBank, quarterBank;
+    if(bank) {
+        doubleEighthBank = createTemplateBank(doubleEighthTempl);
+        quarterBank = createTemplateBank(quarterTempl);
+    }
+    int offset = 0;
+
+    for(int s=0; s < systems.size(); ++s) {
+        Rect system = systems.at(s);
+        NoteSheet noteSheet = splitStaffLinesAndNotes(sheet(system), method);
+        ContoursData contoursDoubleEight, contoursQuarter;
+        if(bank) {
+            contoursDoubleEight = getContoursDataFromBank(noteSheet.notes, doubleEighthBank);
+            contoursQuarter = getContoursDataFromBank(contoursDoubleEight.image, quarterBank);
+        }
+        else {
+            contoursDoubleEight = getContoursData(noteSheet.notes, doubleEighthTempl);
+            contoursQuarter = getContoursData(contoursDoubleEight.image, quarterTempl);
+        }
+        vector<StaffLineData> distances = getStaffLineDistances(noteSheet.staffLines);
+
+        vector<ContoursData> data;
+        data.push_back(contoursDoubleEight);
+        data.push_back(contoursQuarter);
+        vector<Note> notes = convertDataToNote(noteSheet.notes, data, distances, system.height, system.width);
+        Timeline timeline = buildTimeline(noteSheet.notes, notes, distances);
+
+        // Systems follow each other, wait for the synthesis thread if the ring buffer is full
+        for(int n=0; n < timeline.notes.size(); ++n) {
+            TimedNote timed = timeline.notes.at(n);
+            timed.system = s;
+            timed.onset += offset;
+            timed.note.row += system.y;
+            while(!state->notes.push(timed)) {
+                usleep(STREAM_POLL_US);
+            }
+        }
+        offset += timeline.length;
+
+        cerr << "System " << s + 1 << "/" << systems.size() << " recognized after "
+             << (getTickCount() - state->start) * 1000.0 / getTickFrequency() << " ms: "
+             << timeline.notes.size() << " notes" << endl;
+    }
+
+    // Publish the length before finishing, the synthesis thread reads it after the finished flag
+    state->length = offset;
+    CV_XADD(&state->finished, 1);
+    pthread_join(synthesis, NULL);
+
+    cerr << "First sample streamed after " << state->firstSampleMs << " ms, done after "
+         << (getTickCount() - state->start) * 1000.0 / getTickFrequency() << " ms" << endl;
+
+    if(state->sink != stdout) {
+        fclose(state->sink);
+    }
+    delete state;
+
+    return 0;
+}
@@ -0,0 +1,314 @@
+/*
+ * @title Labo beeldinterpretatie 2018: project
+ * @author Dylan Van Assche
+ *
+ * ---> BASIC MUSIC NOTES RECOGNITION <---
+ *
+ * This Proof-Of-Concept (POC) can extract the music notes from a music sheet and save the sound of them into a
+ * WAV audio file.
+ *
+ * Features:
+ *  - Detect non-rotated 1/4 and 1/16 notes using template matching.
+ *  - Find the tone height of each note using the staff lines extraction and vertical histograms.
+ *  - Merge both into a music tone and save it to a WAV audio file using a WAV library.
+ *
+ * Usage:
+ *  - cmake CMakeLists.txt
+ *  - make
+ *  - ./project --sheet=musicSheet.png --output=output.wav --quarter-note=quarter-note.png \
+ *    --double-eighth-note=double-eighth-note.png
+ *
+ */
+#include "notes.h"
+
+// Frequency for each staff position from HIGHEST_STAFF_POSITION to LOWEST_STAFF_POSITION (treble clef)
+const double STAFF_POSITION_FREQUENCIES[] = {
+        NOTE_G, NOTE_F, NOTE_E, NOTE_D, NOTE_C, NOTE_B, NOTE_A, NOTE_G, NOTE_F, NOTE_E, NOTE_D
+};
+
+/*
+ * Default configuration: an A4 page at 300 DPI with 6 staff systems of quarter and double eighth notes, not rotated
+ * and without noise.
+ *
+ * @returns SheetConfig config
+ * @author Dylan Van Assche
+ */
+SheetConfig defaultSheetConfig() {
+    SheetConfig config;
+    config.widthMm = 210.0;
+    config.heightMm = 297.0;
+    config.dpi = 300;
+    config.systems = 6;
+    config.density = 0.8;
+    config.quarterNotes = true;
+    config.doubleEighthNotes = true;
+    config.flipped = 0.0;
+    config.skew = 0.0;
+    config.noise = 0.0;
+    return config;
+}
+
+/*
+ * Private function to render a note glyph in black on a white background, cropped to the ink. The glyph is drawn with
+ * the stem up and rotated by 180 degrees for a flipped note (stem down), like a real music sheet does.
+ *
+ * @param double spacing between the staff lines in pixels
+ * @param GlyphType type
+ * @param bool flipped
+ * @param Point headOffset, center of the (first) note head in the glyph
+ * @returns Mat glyph
+ * @author Dylan Van Assche
+ */
+Mat _renderGlyph(double spacing, GlyphType type, bool flipped, Point &headOffset) {
+    Scalar colorBlack = Scalar::all(0);
+    Size headAxes(cvRound(0.65 * spacing), cvRound(0.45 * spacing));
+    int stemThickness = max(1, cvRound(spacing / 8));
+    int stemLength = cvRound(STEM_LENGTH * spacing);
+    int headDistance = type == GLYPH_DOUBLE_EIGHTH ? cvRound(2.5 * spacing) : 0;
+
+    // Canvas with enough space around the glyph, cropped afterwards
+    Mat canvas(stemLength + cvRound(4 * spacing), headDistance + cvRound(4 * spacing), CV_8UC1, Scalar::all(255));
+    Point head(cvRound(2 * spacing), stemLength + cvRound(2 * spacing));
+
+    for(int h=0; h <= (type == GLYPH_DOUBLE_EIGHTH ? 1 : 0); ++h) {
+        Point center(head.x + h * headDistance, head.y);
+        int stemX = center.x + headAxes.width - stemThickness / 2;
+
+        // Image to draw on, center, axes, angle, start angle, end angle, color, thickness (-1 = fill), line type
+        ellipse(canvas, center, headAxes, -20, 0, 360, colorBlack, -1, LINE_AA);
+        line(canvas, Point(stemX, center.y), Point(stemX, center.y - stemLength), colorBlack, stemThickness);
+    }
+
+    // Beam between both stems of a double eighth note
+    if(type == GLYPH_DOUBLE_EIGHTH) {
+        int left = head.x + headAxes.width - stemThickness;
+        int right = head.x + headDistance + headAxes.width;
+        int top = head.y - stemLength;
+        rectangle(canvas, Point(left, top), Point(right, top + cvRound(0.5 * spacing)), colorBlack, -1);
+    }
+
+    // Crop to the ink
+    vector<Point> ink;
+    findNonZero(canvas < 255, ink);
+    Rect box = boundingRect(ink);
+    Mat glyph = canvas(box).clone();
+    headOffset = Point(head.x - box.x, head.y - box.y);
+
+    // Flip both axes = rotation by 180 degrees
+    if(flipped) {
+        flip(glyph, glyph, -1);
+        headOffset = Point(glyph.cols - 1 - headOffset.x, glyph.rows - 1 - headOffset.y);
+    }
+
+    return glyph;
+}
+
+/*
+ * Renders the template of a note type at the resolution of the configuration. These templates match the notes on the
+ * sheets of renderSheet() and can be used for the template matching in getContoursData().
+ *
+ * @param SheetConfig config
+ * @param GlyphType type
+ * @returns Mat template
+ * @author Dylan Van Assche
+ */
+Mat renderNoteTemplate(SheetConfig config, GlyphType type) {
+    Point headOffset;
+    return _renderGlyph(STAFF_SPACE_MM * config.dpi / 25.4, type, false, headOffset);
+}
+
+/*
+ * Renders a synthetic music sheet: staff systems with randomly placed quarter and double eighth notes and bar lines
+ * after every BEATS_PER_MEASURE beats (a double eighth note is 1 beat). Afterwards, the page can be rotated and noise
+ * can be added to simulate a scan.
+ *
+ * Every note is stored in the ground truth with its bounding box on the final (rotated) page and the frequency and
+ * length the recognizer should find for it: NOTE_LENGTH_4 for a quarter note, NOTE_LENGTH_16 for a double eighth note
+ * (like the templates in main.cpp).
+ *
+ * @param SheetConfig config
+ * @param RNG rng
+ * @param vector<GroundTruthNote> truth
+ * @returns Mat sheet
+ * @author Dylan Van Assche
+ */
+Mat renderSheet(SheetConfig config, RNG &rng, vector<GroundTruthNote> &truth) {
+    double pixelsPerMm = config.dpi / 25.4;
+    double spacing = STAFF_SPACE_MM * pixelsPerMm;
+    double slot = SLOT_WIDTH * spacing;
+    int lineThickness = max(1, cvRound(STAFF_LINE_MM * pixelsPerMm));
+    int margin = cvRound(SHEET_MARGIN_MM * pixelsPerMm);
+    Mat page(cvRound(config.heightMm * pixelsPerMm), cvRound(config.widthMm * pixelsPerMm), CV_8UC1, Scalar::all(255));
+    Rect pageBox(0, 0, page.cols, page.rows);
+    Scalar colorBlack = Scalar::all(0);
+    truth.clear();
+
+    // Render every glyph once: [type][flipped]
+    Mat glyphs[2][2];
+    Point headOffsets[2][2];
+    for(int t=0; t < 2; ++t) {
+        for(int f=0; f < 2; ++f) {
+            glyphs[t][f] = _renderGlyph(spacing, (GlyphType) t, f == 1, headOffsets[t][f]);
+        }
+    }
+
+    // Each staff system is centered in its own band of the page
+    double bandHeight = (double) (page.rows - 2 * margin) / config.systems;
+    for(int s=0; s < config.systems; ++s) {
+        double staffTop = margin + s * bandHeight + (bandHeight - (NUMBER_OF_STAFF_LINES - 1) * spacing) / 2;
+        double staffBottom = staffTop + (NUMBER_OF_STAFF_LINES - 1) * spacing;
+
+        for(int l=0; l < NUMBER_OF_STAFF_LINES; ++l) {
+            int y = cvRound(staffTop + l * spacing);
+            line(page, Point(margin, y), Point(page.cols - margin, y), colorBlack, lineThickness);
+        }
+
+        double x = margin + slot / 2;
+        int beats = 0;
+        int measure = 0;
+        while(x + slot <= page.cols - margin) {
+            // Empty slot
+            if(rng.uniform(0.0, 1.0) >= config.density) {
+                x += slot;
+                continue;
+            }
+
+            // Pick a note type which fits on the staff
+            bool doubleEighthFits = config.doubleEighthNotes && x + 2 * slot <= page.cols - margin;
+            GlyphType type = GLYPH_QUARTER;
+            if(doubleEighthFits && (!config.quarterNotes || rng.uniform(0, 2) == 1)) {
+                type = GLYPH_DOUBLE_EIGHTH;
+            }
+            else if(!config.quarterNotes) {
+                break;
+            }
+
+            int position = rng.uniform(HIGHEST_STAFF_POSITION, LOWEST_STAFF_POSITION + 1);
+            bool flipped = rng.uniform(0.0, 1.0) < config.flipped;
+            Mat glyph = glyphs[type][flipped];
+            Point headOffset = headOffsets[type][flipped];
+            Rect box(
+                    cvRound(x + spacing) - headOffset.x,
+                    cvRound(staffTop + position * spacing / 2) - headOffset.y,
+                    glyph.cols,
+                    glyph.rows
+            );
+
+            // Stems of the outer systems may not leave the page
+            if((box & pageBox) == box) {
+                // Darkest pixel wins, keeps the staff lines visible around the note
+                Mat ROI = page(box);
+                cv::min(ROI, glyph, ROI);
+
+                GroundTruthNote note;
+                note.system = s;
+                note.measure = measure;
+                note.box = box;
+                note.frequency = STAFF_POSITION_FREQUENCIES[position - HIGHEST_STAFF_POSITION];
+                note.length = type == GLYPH_QUARTER ? NOTE_LENGTH_4 : NOTE_LENGTH_16;
+                note.flipped = flipped;
+                truth.push_back(note);
+            }
+            x += type == GLYPH_QUARTER ? slot : 2 * slot;
+
+            // Bar line after a complete measure
+            if(++beats == BEATS_PER_MEASURE) {
+                line(page, Point(cvRound(x), cvRound(staffTop)), Point(cvRound(x), cvRound(staffBottom)), colorBlack, lineThickness);
+                beats = 0;
+                measure++;
+                x += slot / 2;
+            }
+        }
+    }
+
+    // Rotate the page around its center, the bounding boxes of the notes follow the rotation
+    if(config.skew > 0) {
+        double angle = rng.uniform(-config.skew, config.skew);
+        Mat rotation = getRotationMatrix2D(Point2f(page.cols / 2.0f, page.rows / 2.0f), angle, 1.0);
+        warpAffine(page, page, rotation, page.size(), INTER_LINEAR, BORDER_CONSTANT, Scalar::all(255));
+
+        for(int n=0; n < truth.size(); ++n) {
+            Rect box = truth.at(n).box;
+            Mat corners = (Mat_<double>(3, 4) << box.x, box.x + box.width, box.x + box.width, box.x,
+                                                 box.y, box.y, box.y + box.height, box.y + box.height,
+                                                 1, 1, 1, 1);
+            Mat rotated = rotation * corners;
+            vector<Point> points;
+            for(int c=0; c < 4; ++c) {
+                points.push_back(Point(cvRound(rotated.at<double>(0, c)), cvRound(rotated.at<double>(1, c))));
+            }
+            truth.at(n).box = boundingRect(points) & pageBox;
+        }
+    }
+
+    // Gaussian noise, computed in 16 bit to saturate instead of overflow
+    if(config.noise > 0) {
+        Mat noise(page.size(), CV_16SC1);
+        Mat noisy;
+        rng.fill(noise, RNG::NORMAL, 0, config.noise);
+        page.convertTo(noisy, CV_16S);
+        add(noisy, noise, noisy);
+        noisy.convertTo(page, CV_8U);
+    }
+
+    return page;
+}
+
+/*
+ * Writes the ground truth notes of a sheet to a CSV file.
+ *
+ * @param string path
+ * @param vector<GroundTruthNote> truth
+ * @returns bool success
+ * @author Dylan Van Assche
+ */
+bool saveGroundTruth(string path, vector<GroundTruthNote> truth) {
+    ofstream file(path.c_str());
+    if(!file.is_open()) {
+        return false;
+    }
+
+    file << "system,measure,x,y,width,height,frequency,length,flipped" << endl;
+    for(int n=0; n < truth.size(); ++n) {
+        GroundTruthNote note = truth.at(n);
+        file << note.system << ","
+             << note.measure << ","
+             << note.box.x << ","
+             << note.box.y << ","
+             << note.box.width << ","
+             << note.box.height << ","
+             << note.frequency << ","
+             << note.length << ","
+             << note.flipped << endl;
+    }
+
+    return true;
+}
+
+/*
+ * Reads the ground truth notes of a sheet from a CSV file written by saveGroundTruth().
+ * If the file can't be opened, an empty vector is returned.
+ *
+ * @param string path
+ * @returns vector<GroundTruthNote> truth
+ * @author Dylan Van Assche
+ */
+vector<GroundTruthNote> loadGroundTruth(string path) {
+    vector<GroundTruthNote> truth;
+    ifstream file(path.c_str());
+    string row;
+
+    // Skip header
+    getline(file, row);
+    while(getline(file, row)) {
+        GroundTruthNote note;
+        int flipped = 0;
+        if(sscanf(row.c_str(), "%d,%d,%d,%d,%d,%d,%lf,%lf,%d", &note.system, &note.measure, &note.box.x, &note.box.y,
+                  &note.box.width, &note.box.height, &note.frequency, &note.length, &flipped) == 9) {
+            note.flipped = flipped != 0;
+            truth.push_back(note);
+        }
+    }
+
+    return truth;
+}
@@ -0,0 +1,189 @@
+/*
+ * @title Labo beeldinterpretatie 2018: project
+ * @author Dylan Van Assche
+ *
+ * ---> BASIC MUSIC NOTES RECOGNITION <---
+ *
+ * This Proof-Of-Concept (POC) can extract the music notes from a music sheet and save the sound of them into a
+ * WAV audio file.
+ *
+ * Features:
+ *  - Detect non-rotated 1/4 and 1/16 notes using template matching.
+ *  - Find the tone height of each note using the staff lines extraction and vertical histograms.
+ *  - Merge both into a music tone and save it to a WAV audio file using a WAV library.
+ *
+ * Usage:
+ *  - cmake CMakeLists.txt
+ *  - make
+ *  - ./project --sheet=musicSheet.png --output=output.wav --quarter-note=quarter-note.png \
+ *    --double-eighth-note=double-eighth-note.png
+ *
+ */
+#include "notes.h"
+
+// std::sort helper function
+bool sortTimedNotesByOnsetFirst(const TimedNote &a, const TimedNote &b) {
+    if(a.onset != b.onset) {
+        return a.onset < b.onset; // earliest first
+    }
+    return a.note.row < b.note.row; // highest note first for chords
+}
+
+/*
+ * Finds the bar lines of a staff system in the notes image of splitStaffLinesAndNotes(). A bar line is a vertical line
+ * from the top to the bottom staff line: every column which is white for at least BAR_LINE_COVERAGE of the staff
+ * height belongs to a bar line. Stems are shorter than the staff and don't reach the coverage.
+ *
+ * @param Mat notesImage
+ * @param int top staff line
+ * @param int bottom staff line
+ * @returns vector<int> x positions of the bar lines, from left to right
+ * @author Dylan Van Assche
+ */
+vector<int> findBarLines(Mat notesImage, int top, int bottom) {
+    vector<int> barLines;
+    Rect staff = Rect(Point(0, top), Point(notesImage.cols, bottom + 1)) & Rect(0, 0, notesImage.cols, notesImage.rows);
+    if(staff.area() <= 0) {
+        return barLines;
+    }
+
+    /*
+     * Number of white pixels in each column of the staff
+     * Mat input, Mat output, dimension (0 = single row, 1 = single column)
+     */
+    Mat coverage;
+    reduce(notesImage(staff) / THRESHOLD_MAX, coverage, 0, CV_REDUCE_SUM, CV_32S);
+
+    // Neighbouring columns belong to the same (thick) bar line, its center is kept
+    int minimum = cvCeil(BAR_LINE_COVERAGE * staff.height);
+    int start = -1;
+    for(int x=0; x <= coverage.cols; ++x) {
+        bool bar = x < coverage.cols && coverage.at<int>(0, x) >= minimum;
+        if(bar && start < 0) {
+            start = x;
+        }
+        else if(!bar && start >= 0) {
+            barLines.push_back((start + x - 1) / 2);
+            start = -1;
+        }
+    }
+
+    return barLines;
+}
+
+/*
+ * Places the notes of a staff system on a timeline instead of playing them back to back in the order of their x
+ * position. The staff lines of getStaffLineDistances() belong to a single system, a sheet with multiple systems is
+ * cut into systems first (see findStaffSystems()) and their timelines are joined with appendTimeline().
+ *
+ * The bar lines split the notes into measures. The notes of a measure follow each other, a measure takes at least
+ * MEASURE_LENGTH samples: missed notes or rests in a measure don't shift the next measures. Empty measures between
+ * notes are played as a full measure of rest.
+ *
+ * @param Mat notesImage
+ * @param vector<Note> notes
+ * @param vector<StaffLineData> staffLineDistances, sorted by position
+ * @returns Timeline timeline
+ * @author Dylan Van Assche
+ */
+Timeline buildTimeline(Mat notesImage, vector<Note> notes, vector<StaffLineData> staffLineDistances) {
+    Timeline timeline;
+    timeline.length = 0;
+
+    if(staffLineDistances.size() < 2) {
+        cerr << "Number of staff lines is too low to build a timeline: " << staffLineDistances.size() << endl;
+        return timeline;
+    }
+
+    if(notes.empty()) {
+        return timeline;
+    }
+
+    int top = staffLineDistances.at(0).position;
+    int bottom = staffLineDistances.at(staffLineDistances.size() - 1).position;
+    vector<int> barLines = findBarLines(notesImage, top, bottom);
+
+    // Measure of each note = number of bar lines before it, notes stay in the order of their position
+    vector< vector<Note> > notesByMeasure(barLines.size() + 1);
+    for(int n=0; n < notes.size(); ++n) {
+        int measure = 0;
+        while(measure < barLines.size() && barLines.at(measure) < notes.at(n).position) {
+            ++measure;
+        }
+        notesByMeasure.at(measure).push_back(notes.at(n));
+    }
+
+    // Only the measures from the first until the last note are played
+    int first = 0;
+    int last = notesByMeasure.size() - 1;
+    while(notesByMeasure.at(first).empty()) {
+        ++first;
+    }
+    while(notesByMeasure.at(last).empty()) {
+        --last;
+    }
+
+    for(int m=first; m <= last; ++m) {
+        int onset = timeline.length;
+        for(int n=0; n < notesByMeasure.at(m).size(); ++n) {
+            TimedNote timed;
+            timed.note = notesByMeasure.at(m).at(n);
+            timed.system = 0;
+            timed.measure = m;
+            timed.onset = onset;
+            timed.length = (int) timed.note.length;
+            timeline.notes.push_back(timed);
+            onset += timed.length;
+        }
+
+        // Without bar lines the system is a single measure of any length
+        int measureLength = onset - timeline.length;
+        if(!barLines.empty()) {
+            measureLength = max(measureLength, MEASURE_LENGTH);
+        }
+        timeline.length += measureLength;
+    }
+
+    sort(timeline.notes.begin(), timeline.notes.end(), sortTimedNotesByOnsetFirst);
+    return timeline;
+}
+
+/*
+ * Appends the timeline of a staff system to the timeline of the sheet: systems follow each other in the order of the
+ * sheet. The rows of the notes are moved from the system to the sheet.
+ *
+ * @param Timeline timeline of the sheet, updated
+ * @param Timeline systemTimeline
+ * @param int system, index of the system on the sheet
+ * @param int rowOffset, top row of the system on the sheet
+ * @author Dylan Van Assche
+ */
+void appendTimeline(Timeline &timeline, Timeline systemTimeline, int system, int rowOffset) {
+    for(int n=0; n < systemTimeline.notes.size(); ++n) {
+        TimedNote timed = systemTimeline.notes.at(n);
+        timed.system = system;
+        timed.onset += timeline.length;
+        timed.note.row += rowOffset;
+        timeline.notes.push_back(timed);
+    }
+    timeline.length += systemTimeline.length;
+}
+
+/*
+ * Synthesizes a timeline into a single waveform which is allocated once for the complete timeline. Every note is
+ * rendered directly at its onset (see mixWaveform()).
+ *
+ * @param Timeline timeline
+ * @returns vector<short> waveform
+ * @author Dylan Van Assche
+ */
+vector<short> renderTimeline(Timeline timeline) {
+    vector<short> waveform(timeline.length, 0);
+
+    for(int n=0; n < timeline.notes.size(); ++n) {
+        TimedNote timed = timeline.notes.at(n);
+        mixWaveform(waveform, timed.onset, timed.note.frequency, timed.length);
+    }
+
+    return waveform;
+}
@@ -0,0 +1,140 @@
+/*
+ * @title Labo beeldinterpretatie 2018: project
+ * @author Dylan Van Assche
+ *
+ * ---> BASIC MUSIC NOTES RECOGNITION <---
+ *
+ * This Proof-Of-Concept (POC) can extract the music notes from a music sheet and save the sound of them into a
+ * WAV audio file.
+ *
+ * Features:
+ *  - Detect non-rotated 1/4 and 1/16 notes using template matching.
+ *  - Find the tone height of each note using the staff lines extraction and vertical histograms.
+ *  - Merge both into a music tone and save it to a WAV audio file using a WAV library.
+ *
+ * Usage:
+ *  - cmake CMakeLists.txt
+ *  - make
+ *  - ./project --sheet=musicSheet.png --output=output.wav --quarter-note=quarter-note.png \
+ *    --double-eighth-note=double-eighth-note.png
+ *
+ */
+#include "notes.h"
+
+// Number of buffers allocated by all workspaces, proves the steady state doesn't allocate
+static int workspaceAllocations = 0;
+
+/*
+ * Per thread pool of reusable buffers for the intermediate images of the pipeline. A buffer is reused for a request
+ * with the same size and type, it's free when the workspace holds its only reference. Results which are still used by
+ * the caller (NoteSheet, ContoursData.image, ...) are never handed out twice, they become free again when the caller
+ * releases them.
+ *
+ * Every staff system, tile or edited region can have another size: at most WORKSPACE_MAX_BUFFERS buffers are kept,
+ * above that the least recently used free buffers are dropped. Buffers in use are never dropped.
+ *
+ * @author Dylan Van Assche
+ */
+class Workspace {
+public:
+    Workspace() : clock(0) {}
+
+    Mat acquire(Size size, int type) {
+        // Empty images don't own a buffer
+        if(size.area() <= 0) {
+            return Mat(size, type);
+        }
+
+        // Results handed to the caller can be released by another thread, the reference count is read atomically
+        ++clock;
+        for(int b=0; b < buffers.size(); ++b) {
+            Mat &buffer = buffers.at(b);
+            if(_isFree(buffer) && buffer.size() == size && buffer.type() == type) {
+                lastUse.at(b) = clock;
+                return buffer;
+            }
+        }
+
+        // First use of this size and type or all its buffers are in use
+        _evict();
+        buffers.push_back(Mat(size, type));
+        lastUse.push_back(clock);
+        CV_XADD(&workspaceAllocations, 1);
+        return buffers.back();
+    }
+
+    void release() {
+        buffers.clear();
+        lastUse.clear();
+    }
+
+private:
+    vector<Mat> buffers;
+    vector<int64> lastUse; // value of clock when the buffer was handed out
+    int64 clock;
+
+    static bool _isFree(Mat &buffer) {
+        return CV_XADD(&buffer.u->refcount, 0) == 1;
+    }
+
+    // Drops the least recently used free buffers until there's room for a new one
+    void _evict() {
+        while(buffers.size() >= WORKSPACE_MAX_BUFFERS) {
+            int oldest = -1;
+            for(int b=0; b < buffers.size(); ++b) {
+                if(_isFree(buffers.at(b)) && (oldest < 0 || lastUse.at(b) < lastUse.at(oldest))) {
+                    oldest = b;
+                }
+            }
+            if(oldest < 0) {
+                return;
+            }
+            buffers.erase(buffers.begin() + oldest);
+            lastUse.erase(lastUse.begin() + oldest);
+        }
+    }
+};
+
+static TLSData<Workspace> workspaces;
+
+/*
+ * Returns a buffer of the workspace of the calling thread. The content of the buffer is undefined, it's only reused
+ * once all Mat headers returned for it are released.
+ *
+ * @param Size size
+ * @param int type
+ * @returns Mat buffer
+ * @author Dylan Van Assche
+ */
+Mat acquireWorkspaceBuffer(Size size, int type) {
+    return workspaces.get()->acquire(size, type);
+}
+
+/*
+ * Frees all the buffers of the workspace of the calling thread, for example after a batch of sheets with another size.
+ * Buffers still used by the caller stay valid until they are released.
+ *
+ * @author Dylan Van Assche
+ */
+void releaseWorkspace() {
+    workspaces.get()->release();
+}
+
+/*
+ * Number of buffers allocated by the workspaces of all threads since the last resetWorkspaceAllocationCount().
+ *
+ * @returns int allocations
+ * @author Dylan Van Assche
+ */
+int workspaceAllocationCount() {
+    return CV_XADD(&workspaceAllocations, 0);
+}
+
+/*
+ * Resets the workspace allocation counter to zero.
+ *
+ * @author Dylan Van Assche
+ */
+void resetWorkspaceAllocationCount() {
+    workspaceAllocations = 0;
+}
@@ -0,0 +1,96 @@
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include "channels.h"
+#include "timing.h"
+
+using namespace std;
+using namespace cv;
+
+// Planes of the last call, the grey image is the output of the implementations
+Mat planes[3];
+
+// main.cpp before the fused kernel: split() and cvtColor() both read the whole color image
+void splitThenGrey(const Mat &colorImg, Mat &grey) {
+    split(colorImg, planes);
+    cvtColor(colorImg, grey, COLOR_BGR2GRAY);
+}
+
+// Planes and grey image in a single pass
+void splitGreyFused(const Mat &colorImg, Mat &grey) {
+    splitGrey(colorImg, planes, grey);
+}
+
+int main(int argc, const char** argv) {
+    CommandLineParser parser(argc, argv,
+                             "{ help h usage ? |    | Shows this message.}"
+                             "{ color c        |    | Loads a color image <REQUIRED> }"
+                             "{ scale s        | 4  | Resize factor of the image, small images fit in the cache }"
+                             "{ iterations i   | 20 | Number of measured calls per implementation }"
+    );
+
+    // Help printing
+    if(parser.has("help") || argc <= 1) {
+        cerr << "Please use absolute paths when supplying your images." << endl;
+        parser.printMessage();
+        return 0;
+    }
+
+    // Parser fail
+    if (!parser.check())
+    {
+        parser.printErrors();
+        return -1;
+    }
+
+    // Required arguments supplied?
+    string color(parser.get<string>("color"));
+    double scale = parser.get<double>("scale");
+    int iterations = parser.get<int>("iterations");
+    if(color.empty() || scale <= 0 || iterations <= 0)
+    {
+        cerr << "Please supply your images using command line arguments: --color=testColor.png --scale=4 --iterations=20" << endl;
+        return -1;
+    }
+
+    // Try to load images
+    Mat colorImg; // BGR
+    colorImg = imread(color, IMREAD_COLOR);
+
+    if(colorImg.empty()) {
+        cerr << "Loading images failed, please verify the paths to the images." << endl;
+        return -1;
+    }
+    resize(colorImg, colorImg, Size(), scale, scale, INTER_LINEAR);
+
+    // The fused kernel must give the same planes and grey image as split() + cvtColor()
+    const char *names[] = {"split+cvtColor", "fused"};
+    BenchmarkImplementation implementations[] = {splitThenGrey, splitGreyFused};
+    Mat referencePlanes[3], referenceGrey;
+    bool identical = true;
+
+    printBenchmarkHeader();
+    for(int i = 0; i < 2; i++) {
+        Mat grey;
+        double ms = timeImplementation(implementations[i], colorImg, grey, iterations);
+        if(referenceGrey.empty()) {
+            for(int c = 0; c < 3; c++) {
+                referencePlanes[c] = planes[c].clone();
+            }
+            referenceGrey = grey;
+        }
+        bool same = countNonZero(grey != referenceGrey) == 0;
+        for(int c = 0; c < 3; c++) {
+            same = same && countNonZero(planes[c] != referencePlanes[c]) == 0;
+        }
+        identical = identical && same;
+
+        printBenchmarkRow(names[i], colorImg, iterations, ms, same);
+    }
+
+    if(!identical) {
+        cerr << "The results of the implementations differ!" << endl;
+        return -2;
+    }
+
+    return 0;
+}
@@ -1,5 +1,7 @@
 #include <iostream>
 #include <opencv2/opencv.hpp>
+#include "pixeldump.h"
+#include "channels.h"
 
 using namespace std;
 using namespace cv;
@@ -9,6 +11,7 @@ int main(int argc, const char** argv) {
                              "{ help h usage ? | | Shows this message.}"
                              "{ grey g         | | Loads a grey image <REQUIRED> }"
                              "{ color c        | | Loads a color image <REQUIRED> }"
+                             "{ dump d         | | Saves the pixels of the color to grey image to this file (.pgm, .npy or text) instead of printing them }"
     );
 
     // Help printing
@@ -51,9 +54,11 @@ int main(int argc, const char** argv) {
     imshow("Grey image", greyImg);
     imshow("Color image", colorImg);
 
-    // Splitting color channels
+    // Splitting color channels and transforming the color image to a grey image in one pass over the image, gives the
+    // same result as split() and cvtColor(COLOR_BGR2GRAY) which read the whole color image each (see lib/channels.cpp)
     Mat splitted[3];
-    split(colorImg, splitted);
+    Mat colorImg2Grey;
+    splitGrey(colorImg, splitted, colorImg2Grey);
 
     namedWindow("Color BLUE channel");
     namedWindow("Color GREEN channel");
@@ -62,22 +67,20 @@ int main(int argc, const char** argv) {
     imshow("Color GREEN channel", splitted[1]);
     imshow("Color RED channel", splitted[2]);
 
-    // Transform color image to grey image using cvtColor
-    Mat colorImg2Grey;
-    cvtColor(colorImg, colorImg2Grey, COLOR_BGR2GRAY);
     namedWindow("Color to grey");
     imshow("Color to grey", colorImg2Grey);
 
-    // Print all pixels of our color2grey image to the command line;
-    for(int rowIndex = 0; rowIndex < colorImg2Grey.rows; rowIndex++)
-    {
-        for(int columnIndex = 0; columnIndex < colorImg2Grey.cols; columnIndex++) {
-            cout << (int)colorImg2Grey.at<uchar>(rowIndex, columnIndex); // typecasting to show it properly in the terminal
-            cout << " ";
-        }
-        cout << endl; // new line when row++
+    // Print all pixels of our color2grey image to the command line or dump them to a file for offline analysis.
+    // The rows are formatted into a large buffer and written at once, printing every pixel with cout and flushing
+    // every row with endl takes minutes for large images (see lib/pixeldump.cpp).
+    string dump(parser.get<string>("dump"));
+    if(dump.empty()) {
+        writePixelsText(cout, colorImg2Grey);
+    }
+    else if(!savePixels(dump, colorImg2Grey)) {
+        cerr << "Saving the pixels failed, please verify the path: " << dump << endl;
+        return -1;
     }
-    cout << endl;
 
     // Canvas circle + rectangle + line drawing
     Mat canvas = Mat::zeros(512, 512, CV_8UC3); // 512 x 512 pixel: 8 bits unsigned integer 3 channels, all black
@@ -0,0 +1,120 @@
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include "skin.h"
+#include "colorlut.h"
+#include "timing.h"
+
+using namespace std;
+using namespace cv;
+
+// Approach 1 of main.cpp without printing the pixels: looping through all the pixels using a double for loop
+void skinMaskLoop(const Mat &colorImg, Mat &maskerLoop) {
+    maskerLoop.create(colorImg.size(), CV_8UC1);
+    for(int rowIndex = 0; rowIndex < colorImg.rows; rowIndex++)
+    {
+        for(int columnIndex = 0; columnIndex < colorImg.cols; columnIndex++) {
+            int blue = (int)colorImg.at<Vec3b>(rowIndex, columnIndex)[0];
+            int green = (int)colorImg.at<Vec3b>(rowIndex, columnIndex)[1];
+            int red = (int)colorImg.at<Vec3b>(rowIndex, columnIndex)[2];
+            // Filter formula from the assignment
+            if((red > 95) && (green > 40) && (blue > 20) && ((max(red, max(green, blue)) - min(red, min(green, blue))) > 15) && (abs(red - green) > 15) && (red > green) && (red > blue))
+            {
+                maskerLoop.at<uchar>(rowIndex, columnIndex) = 255;
+            }
+            else {
+                maskerLoop.at<uchar>(rowIndex, columnIndex) = 0;
+            }
+        }
+    }
+}
+
+// Approach 2 of main.cpp: OpenCV matrix operations, every operation creates a temporary image
+void skinMaskMatrix(const Mat &colorImg, Mat &maskerMatrixOperation) {
+    Mat splitted[3];
+    split(colorImg, splitted);
+    Mat blue = splitted[0];
+    Mat green = splitted[1];
+    Mat red = splitted[2];
+    maskerMatrixOperation = (red > 95) & (green > 40) & (blue > 20) & ((max(red, max(green, blue)) - min(red, min(green, blue))) > 15) & (abs(red - green) > 15) & (red > green) & (red > blue);
+}
+
+// Skin rule compiled into a colour lookup table, compiled once in main()
+ColorLut skinLut;
+
+void skinMaskLut(const Mat &colorImg, Mat &maskerLut) {
+    applyColorLut(skinLut, colorImg, maskerLut);
+}
+
+int main(int argc, const char** argv) {
+    CommandLineParser parser(argc, argv,
+                             "{ help h usage ? |    | Shows this message.}"
+                             "{ color c        |    | Loads a color image <REQUIRED> }"
+                             "{ scale s        | 4  | Resize factor of the image, small images fit in the cache }"
+                             "{ iterations i   | 20 | Number of measured calls per implementation }"
+    );
+
+    // Help printing
+    if(parser.has("help") || argc <= 1) {
+        cerr << "Please use absolute paths when supplying your images." << endl;
+        parser.printMessage();
+        return 0;
+    }
+
+    // Parser fail
+    if (!parser.check())
+    {
+        parser.printErrors();
+        return -1;
+    }
+
+    // Required arguments supplied?
+    string color(parser.get<string>("color"));
+    double scale = parser.get<double>("scale");
+    int iterations = parser.get<int>("iterations");
+    if(color.empty() || scale <= 0 || iterations <= 0)
+    {
+        cerr << "Please supply your images using command line arguments: --color=imageColor.jpg --scale=4 --iterations=20" << endl;
+        return -1;
+    }
+
+    // Try to load images
+    Mat colorImg; // BGR
+    colorImg = imread(color, IMREAD_COLOR);
+
+    if(colorImg.empty()) {
+        cerr << "Loading images failed, please verify the paths to the images." << endl;
+        return -1;
+    }
+    resize(colorImg, colorImg, Size(), scale, scale, INTER_NEAREST);
+
+    // The lookup table is compiled once, it can be reused for every image afterwards
+    int64 start = getTickCount();
+    compileColorLut(skinLut, skinRule, NULL);
+    cerr << "Compiled the skin lookup table in " << (getTickCount() - start) * 1000.0 / getTickFrequency() << " ms" << endl;
+
+    // All implementations must give the same mask as the pixel loop
+    const char *names[] = {"loop", "matrix", "fused", "lut"};
+    BenchmarkImplementation implementations[] = {skinMaskLoop, skinMaskMatrix, skinMask, skinMaskLut};
+    Mat reference;
+    bool identical = true;
+
+    printBenchmarkHeader();
+    for(int i = 0; i < 4; i++) {
+        Mat mask;
+        double ms = timeImplementation(implementations[i], colorImg, mask, iterations);
+        if(reference.empty()) {
+            reference = mask;
+        }
+        bool same = countNonZero(mask != reference) == 0;
+        identical = identical && same;
+
+        printBenchmarkRow(names[i], colorImg, iterations, ms, same);
+    }
+
+    if(!identical) {
+        cerr << "The masks of the implementations differ!" << endl;
+        return -2;
+    }
+
+    return 0;
+}
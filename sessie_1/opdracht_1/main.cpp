@@ -1,5 +1,7 @@
 #include <iostream>
 #include <opencv2/opencv.hpp>
+#include "skin.h"
+#include "colorlut.h"
 
 using namespace std;
 using namespace cv;
@@ -98,6 +100,35 @@ int main(int argc, const char** argv) {
     imshow("Segmentation matrix operations", segmentationMatrixOperation);
     waitKey(0); // Wait until the user presses a key
 
+    // Approach 3: fused SIMD kernel, the complete filter in a single pass without temporary images (see lib/skin.cpp)
+    Mat maskerFused;
+    Mat segmentationFused(colorImg.size(), CV_8UC3);
+    skinMask(colorImg, maskerFused);
+    // Combine masker and image
+    colorImg.copyTo(segmentationFused, maskerFused);
+
+    namedWindow("Skin extraction fused kernel", WINDOW_AUTOSIZE);
+    imshow("Skin extraction fused kernel", maskerFused);
+    namedWindow("Segmentation fused kernel", WINDOW_AUTOSIZE);
+    imshow("Segmentation fused kernel", segmentationFused);
+    waitKey(0); // Wait until the user presses a key
+
+    // Approach 4: colour lookup table, the filter is evaluated once for all 256^3 colours and stored as 1 bit per
+    // colour (2 MB), every pixel is a single table lookup afterwards (see lib/colorlut.cpp)
+    ColorLut skinLut;
+    Mat maskerLut;
+    Mat segmentationLut(colorImg.size(), CV_8UC3);
+    compileColorLut(skinLut, skinRule, NULL);
+    applyColorLut(skinLut, colorImg, maskerLut);
+    // Combine masker and image
+    colorImg.copyTo(segmentationLut, maskerLut);
+
+    namedWindow("Skin extraction lookup table", WINDOW_AUTOSIZE);
+    imshow("Skin extraction lookup table", maskerLut);
+    namedWindow("Segmentation lookup table", WINDOW_AUTOSIZE);
+    imshow("Segmentation lookup table", segmentationLut);
+    waitKey(0); // Wait until the user presses a key
+
     // Bimodal OTSU
     namedWindow("OTSU original", WINDOW_AUTOSIZE);
     imshow("OTSU original", bimodalImg);
@@ -1,13 +1,107 @@
 #include <iostream>
 #include <opencv2/opencv.hpp>
+#include "skin.h"
+#include "clahe.h"
+#include "morphology.h"
 
 using namespace std;
 using namespace cv;
 
+#define OPENING_ITER 2 // noise suppression x2 due huge pixels
+#define CLOSING_ITER 5 // connect blobs, more times than removing noise
+#define CLAHE_TILES 15
+#define CLAHE_CLIP_LIMIT 1
+#define FPS_REPORT_INTERVAL 100 // frames
+
+/*
+ * Headless version of the pipeline below for recorded footage: skin mask, opening, closing, convex hulls, CLAHE and
+ * OTSU for every frame of a video. Nothing is shown and nothing waits for a key. All images, the contour and hull
+ * vectors and the CLAHE object live outside the frame loop, so after the first frame OpenCV reuses their buffers
+ * instead of allocating new ones.
+ *
+ * The contrast normalization uses the temporal CLAHE of lib/clahe.cpp by default: it reuses the tile histograms and
+ * LUTs of the previous frame and only recomputes what changed. temporalClahe = false uses cv::CLAHE on every frame.
+ *
+ * @param VideoCapture capture, opened
+ * @param string output, optional video file for the OTSU result
+ * @param bool temporalClahe
+ * @returns int 0 on success, -1 when the output video can't be opened
+ * @author Dylan Van Assche
+ */
+int processVideo(VideoCapture &capture, const string &output, bool temporalClahe) {
+    Mat frame, masker, contouredImg, greyed, equalized, threshed, thresholdedBGR;
+    vector< vector<Point> > contours;
+    vector< vector<Point> > hulls;
+    Ptr<CLAHE> clahe_p = createCLAHE(CLAHE_CLIP_LIMIT, Size(CLAHE_TILES, CLAHE_TILES));
+    TemporalClahe clahe;
+    initTemporalClahe(clahe, CLAHE_CLIP_LIMIT, Size(CLAHE_TILES, CLAHE_TILES));
+    VideoWriter writer;
+    int frames = 0;
+
+    int64 start = getTickCount();
+    int64 intervalStart = start;
+    while(capture.read(frame)) {
+        // Skin mask, opening and closing
+        skinMask(frame, masker);
+        openCloseMask(masker, masker, OPENING_ITER, CLOSING_ITER);
+
+        // Convex hulls of the blobs, the inner vectors of hulls keep their capacity between frames
+        findContours(masker, contours, RETR_EXTERNAL, CHAIN_APPROX_NONE); // masker is not needed anymore afterwards
+        hulls.resize(contours.size());
+        for(size_t i=0; i < contours.size(); i++) {
+            convexHull(contours[i], hulls[i]);
+        }
+        masker.setTo(0);
+        drawContours(masker, hulls, -1, 255, -1);
+
+        contouredImg.create(frame.size(), CV_8UC3);
+        contouredImg.setTo(0);
+        frame.copyTo(contouredImg, masker);
+
+        // CLAHE + OTSU
+        cvtColor(contouredImg, greyed, COLOR_BGR2GRAY);
+        if(temporalClahe) {
+            applyTemporalClahe(clahe, greyed, equalized);
+        }
+        else {
+            clahe_p->apply(greyed, equalized);
+        }
+        threshold(equalized, threshed, 0, 255, CV_THRESH_BINARY | CV_THRESH_OTSU);
+
+        if(!output.empty()) {
+            if(!writer.isOpened()) {
+                double fps = capture.get(CAP_PROP_FPS);
+                writer.open(output, VideoWriter::fourcc('M', 'J', 'P', 'G'), fps > 0 ? fps : 25, frame.size());
+                if(!writer.isOpened()) {
+                    cerr << "Opening the output video failed: " << output << endl;
+                    return -1;
+                }
+            }
+            cvtColor(threshed, thresholdedBGR, COLOR_GRAY2BGR);
+            writer.write(thresholdedBGR);
+        }
+
+        frames++;
+        if(frames % FPS_REPORT_INTERVAL == 0) {
+            int64 now = getTickCount();
+            cerr << "Frame " << frames << ": " << FPS_REPORT_INTERVAL * getTickFrequency() / (now - intervalStart) << " fps" << endl;
+            intervalStart = now;
+        }
+    }
+    double seconds = (getTickCount() - start) / getTickFrequency();
+
+    cout << "frames,width,height,seconds,fps" << endl;
+    cout << frames << "," << frame.cols << "," << frame.rows << "," << seconds << "," << (seconds > 0 ? frames / seconds : 0) << endl;
+    return 0;
+}
+
 int main(int argc, const char** argv) {
     CommandLineParser parser(argc, argv,
                              "{ help h usage ? | | Shows this message.}"
                              "{ color c        | | Loads a color image <REQUIRED> }"
+                             "{ video v        | | Processes a video file headless instead of an image, reports the frames per second }"
+                             "{ output o       | | Saves the OTSU result of --video to this video file }"
+                             "{ clahe          | temporal | CLAHE of --video: temporal (reuses the previous frame) or opencv }"
     );
 
     // Help printing
@@ -24,11 +118,27 @@ int main(int argc, const char** argv) {
         return -1;
     }
 
+    // Video mode
+    string video(parser.get<string>("video"));
+    if(!video.empty()) {
+        VideoCapture capture(video);
+        if(!capture.isOpened()) {
+            cerr << "Loading video failed, please verify the path to the video." << endl;
+            return -1;
+        }
+        string clahe(parser.get<string>("clahe"));
+        if(clahe != "temporal" && clahe != "opencv") {
+            cerr << "Unknown CLAHE: " << clahe << ", use --clahe=temporal or --clahe=opencv" << endl;
+            return -1;
+        }
+        return processVideo(capture, parser.get<string>("output"), clahe == "temporal");
+    }
+
     // Required arguments supplied?
     string color(parser.get<string>("color"));
     if(color.empty())
     {
-        cerr << "Please supply your images using command line arguments: --color=imageColorAdapted.jpg" << endl;
+        cerr << "Please supply your images using command line arguments: --color=imageColorAdapted.jpg or --video=footage.avi" << endl;
         return -1;
     }
 
@@ -42,77 +152,36 @@ int main(int argc, const char** argv) {
     }
 
     // Thresholding skin pixels
-    // Approach 1: looping through all the pixels using a double for lus
-    // Print all pixels of our colorImg image to the command line;
-    Mat maskerLoop(colorImg.size(), CV_8UC1);
-    Mat segmentationLoop(colorImg.size(), CV_8UC3);
-    for(int rowIndex = 0; rowIndex < colorImg.rows; rowIndex++)
-    {
-        for(int columnIndex = 0; columnIndex < colorImg.cols; columnIndex++) {
-            cout << "(" << (int)colorImg.at<Vec3b>(rowIndex, columnIndex)[0] << "," << (int)colorImg.at<Vec3b>(rowIndex, columnIndex)[1] << "," << (int)colorImg.at<Vec3b>(rowIndex, columnIndex)[2] << ")"; // typecasting to show it properly in the terminal
-            cout << " ";
-            int blue = (int)colorImg.at<Vec3b>(rowIndex, columnIndex)[0];
-            int green = (int)colorImg.at<Vec3b>(rowIndex, columnIndex)[1];
-            int red = (int)colorImg.at<Vec3b>(rowIndex, columnIndex)[2];
-            // Filter formula from the assignment
-            if((red > 95) && (green > 40) && (blue > 20) && ((max(red, max(green, blue)) - min(red, min(green, blue))) > 15) && (abs(red - green) > 15) && (red > green) && (red > blue))
-            {
-                maskerLoop.at<uchar>(rowIndex, columnIndex) = 255;
-            }
-            else {
-                maskerLoop.at<uchar>(rowIndex, columnIndex) = 0;
-            }
-        }
-        cout << endl; // new line when row++
-    }
-    cout << endl;
-
-    // Combine masker and image
-    colorImg.copyTo(segmentationLoop, maskerLoop);
-
-    namedWindow("Skin extraction pixel loop", WINDOW_AUTOSIZE);
-    imshow("Skin extraction pixel loop", maskerLoop);
-    namedWindow("Segmentation pixel loop", WINDOW_AUTOSIZE);
-    imshow("Segmentation pixel loop", segmentationLoop);
-    waitKey(0); // Wait until the user presses a key
-
-    // Approach 2: using OpenCV matrix operations to retrieve all the pixels (binary image) that are valid for the filter
-    Mat splitted[3];
-    Mat maskerMatrixOperation(colorImg.size(), CV_8UC1);
-    Mat segmentationMatrixOperation(colorImg.size(), CV_8UC3);
-    split(colorImg, splitted);
-    Mat blue = splitted[0]; // merge() replaces this boiler plate code
-    Mat green = splitted[1];
-    Mat red = splitted[2];
-    maskerMatrixOperation = (red > 95) & (green > 40) & (blue > 20) & ((max(red, max(green, blue)) - min(red, min(green, blue))) > 15) & (abs(red - green) > 15) & (red > green) & (red > blue);
+    // Fused SIMD kernel: the filter formula from the assignment in a single pass over the image (see lib/skin.cpp)
+    Mat masker;
+    Mat segmentation(colorImg.size(), CV_8UC3);
+    skinMask(colorImg, masker);
     // Combine masker and image
-    colorImg.copyTo(segmentationMatrixOperation, maskerMatrixOperation);
+    colorImg.copyTo(segmentation, masker);
 
-    namedWindow("Skin extraction matrix operations", WINDOW_AUTOSIZE);
-    imshow("Skin extraction matrix operations", maskerMatrixOperation);
-    namedWindow("Segmentation matrix operations", WINDOW_AUTOSIZE);
-    imshow("Segmentation matrix operations", segmentationMatrixOperation);
+    namedWindow("Skin extraction", WINDOW_AUTOSIZE);
+    imshow("Skin extraction", masker);
+    namedWindow("Segmentation", WINDOW_AUTOSIZE);
+    imshow("Segmentation", segmentation);
     waitKey(0); // Wait until the user presses a key
 
     // Optimize mask with opening, closing; dilation and erosion
     cerr << "Optimizing mask" << endl;
-    erode(maskerMatrixOperation, maskerMatrixOperation, Mat(), Point(-1, -1), 2); // noise suppression x2 due huge pixels
-    dilate(maskerMatrixOperation, maskerMatrixOperation, Mat(), Point(-1, -1), 2); // fix erode data loss
+    openMask(masker, masker, OPENING_ITER); // noise suppression x2 due huge pixels, then fix erode data loss
     namedWindow("Remove noise", WINDOW_AUTOSIZE);
-    imshow("Remove noise", maskerMatrixOperation);
+    imshow("Remove noise", masker);
     waitKey(0);
 
     // Connect blobs
-    dilate(maskerMatrixOperation, maskerMatrixOperation, Mat(), Point(-1, -1), 5); // connect blobs, more times than removing noise
-    erode(maskerMatrixOperation, maskerMatrixOperation, Mat(), Point(-1, -1), 5); // fix dilate data loss
+    closeMask(masker, masker, CLOSING_ITER); // connect blobs, more times than removing noise, then fix dilate data loss
     namedWindow("Connect blobs", WINDOW_AUTOSIZE);
-    imshow("Connect blobs", maskerMatrixOperation);
+    imshow("Connect blobs", masker);
     waitKey(0);
 
     // Convex hull approach -> contours
     vector< vector<Point> > contours;
     // Find contours of a binary image.
-    findContours(maskerMatrixOperation.clone(), contours, RETR_EXTERNAL, CHAIN_APPROX_NONE); // explain defines
+    findContours(masker.clone(), contours, RETR_EXTERNAL, CHAIN_APPROX_NONE); // explain defines
     vector< vector<Point> > hulls;
     for(size_t i=0; i < contours.size(); i++) {
         vector<Point> hull;
@@ -121,10 +190,10 @@ int main(int argc, const char** argv) {
         hulls.push_back(hull);
     }
     // input image, contours, contourIdx (-1 = draw all contours), color, thickness (< 0, draw contour interiors), lineType, hierarchy, maxLevel, offset
-    drawContours(maskerMatrixOperation, hulls, -1, 255, -1); // check docs -1
+    drawContours(masker, hulls, -1, 255, -1); // check docs -1
 
     Mat contouredImg(colorImg.size(), CV_8UC3);
-    colorImg.copyTo(contouredImg, maskerMatrixOperation);
+    colorImg.copyTo(contouredImg, masker);
     namedWindow("Draw contours", WINDOW_AUTOSIZE);
     imshow("Draw contours", contouredImg);
     waitKey(0);
@@ -166,8 +235,8 @@ int main(int argc, const char** argv) {
     Mat bimodalImgCLAHE;
     Mat threshedImgCLAHE;
     Ptr<CLAHE> clahe_p = createCLAHE();
-    clahe_p->setTilesGridSize(Size(15, 15)); // window size
-    clahe_p->setClipLimit(1); // 1 - 10 contrast
+    clahe_p->setTilesGridSize(Size(CLAHE_TILES, CLAHE_TILES)); // window size
+    clahe_p->setClipLimit(CLAHE_CLIP_LIMIT); // 1 - 10 contrast
     clahe_p->apply(colorImgGreyed.clone(), bimodalImgCLAHE); // still old C function, use .clone() to be sure
     threshold(bimodalImgCLAHE, threshedImgCLAHE, 0, 255, CV_THRESH_BINARY | CV_THRESH_OTSU);
     namedWindow("OTSU CLAHE", WINDOW_AUTOSIZE);
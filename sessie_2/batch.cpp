@@ -0,0 +1,182 @@
+#include <cctype>
+#include <fstream>
+#include "batch.h"
+
+/*
+ * Buffers of a batch worker thread, reused for every image the thread processes.
+ */
+typedef struct BatchBuffers {
+    BitMask mask; // segmentation and closing stay bit-packed
+    Mat closed;
+    Mat crop;
+} BatchBuffers;
+
+static TLSData<BatchBuffers> batchBuffers;
+
+/*
+ * Returns the file name of a path without directory, the extension is kept so a.jpg and a.png get different crops.
+ *
+ * @param string path
+ * @returns string
+ * @author Dylan Van Assche
+ */
+string _fileName(const string &path) {
+    size_t slash = path.find_last_of("/\\");
+    return slash == string::npos ? path : path.substr(slash + 1);
+}
+
+/*
+ * Returns true when the file is an image to process: an extension in BATCH_EXTENSIONS and not a crop of a previous
+ * run (BATCH_CROP_SUFFIX), since the output directory can be the input directory.
+ *
+ * @param string path
+ * @returns bool
+ * @author Dylan Van Assche
+ */
+bool _isBatchImage(const string &path) {
+    string name = _fileName(path);
+    string suffix = BATCH_CROP_SUFFIX;
+    if(name.size() >= suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0) {
+        return false;
+    }
+
+    size_t dot = name.rfind('.');
+    if(dot == string::npos) {
+        return false;
+    }
+    string extension = name.substr(dot) + ".";
+    for(size_t i=0; i < extension.size(); ++i) {
+        extension[i] = (char)tolower((unsigned char)extension[i]);
+    }
+    return string(BATCH_EXTENSIONS).find(extension) != string::npos;
+}
+
+/*
+ * Segments the red sign of one image and saves the crop of its bounding box: the same steps as the interactive mode
+ * (colour lookup table, closing, convex hull of the biggest blob) without windows.
+ *
+ * @param string path
+ * @param string output directory
+ * @param ColorLut redLut
+ * @param BatchBuffers buffers of the calling thread
+ * @param BatchResult result output
+ * @author Dylan Van Assche
+ */
+void _extractSign(const string &path, const string &output, const ColorLut &redLut, BatchBuffers &buffers, BatchResult &result) {
+    int64 start = getTickCount();
+    result.status = "none";
+    result.box = Rect();
+    result.area = 0;
+
+    Mat signImg = imread(path, IMREAD_COLOR);
+    if(signImg.empty()) {
+        result.status = "error";
+    }
+    else {
+        applyColorLut(redLut, signImg, buffers.mask);
+        dilateBitMask(buffers.mask, BATCH_CLOSING_ITER);
+        erodeBitMask(buffers.mask, BATCH_CLOSING_ITER);
+        unpackBitMask(buffers.mask, buffers.closed);
+
+        Blob biggest;
+        if(findLargestBlob(buffers.closed, biggest) && biggest.area >= BATCH_MIN_BLOB_AREA) {
+            vector< vector<Point> > hulls(1, biggest.hull);
+            drawContours(buffers.closed, hulls, -1, 255, -1);
+
+            // Crop of the bounding box, only the pixels of the sign
+            buffers.crop.create(biggest.box.size(), CV_8UC3);
+            buffers.crop.setTo(Scalar::all(0));
+            signImg(biggest.box).copyTo(buffers.crop, buffers.closed(biggest.box));
+
+            result.box = biggest.box;
+            result.area = biggest.area;
+            result.status = imwrite(output + "/" + _fileName(path) + BATCH_CROP_SUFFIX, buffers.crop) ? "crop" : "error";
+        }
+    }
+
+    result.ms = (getTickCount() - start) * 1000.0 / getTickFrequency();
+}
+
+/*
+ * Worker pool: every thread processes a range of images of the current chunk with its own buffers.
+ *
+ * @author Dylan Van Assche
+ */
+class BatchWorkers : public ParallelLoopBody {
+public:
+    BatchWorkers(const vector<String> &files, int offset, const string &output, const ColorLut &redLut, vector<BatchResult> &results)
+            : files(files), offset(offset), output(output), redLut(redLut), results(results) {}
+
+    void operator()(const Range &range) const {
+        BatchBuffers *buffers = batchBuffers.get();
+        for(int i=range.start; i < range.end; ++i) {
+            _extractSign(files.at(offset + i), output, redLut, *buffers, results.at(i));
+        }
+    }
+
+private:
+    const vector<String> &files;
+    int offset;
+    const string &output;
+    const ColorLut &redLut;
+    vector<BatchResult> &results;
+};
+
+/*
+ * Headless batch mode: extracts the red sign of every image (BATCH_EXTENSIONS) in a directory. The crops are saved
+ * as <output>/<image>.<extension>_sign.png and the bounding boxes with the time per image in <output>/BATCH_CSV.
+ *
+ * @param string directory with the images
+ * @param string output directory, must exist
+ * @param ColorLut redLut, compiled red range
+ * @param int workers, number of threads (0 = OpenCV default)
+ * @returns int 0 on success, -1 when the directory is empty or the CSV can't be written
+ * @author Dylan Van Assche
+ */
+int runBatch(const string &directory, const string &output, const ColorLut &redLut, int workers) {
+    vector<String> found, files;
+    glob(directory, found, false);
+    for(size_t i=0; i < found.size(); ++i) {
+        if(_isBatchImage(found[i])) {
+            files.push_back(found[i]);
+        }
+    }
+    if(files.empty()) {
+        cerr << "No images found in " << directory << endl;
+        return -1;
+    }
+
+    ofstream csv((output + "/" + BATCH_CSV).c_str());
+    if(!csv) {
+        cerr << "Writing " << BATCH_CSV << " failed, please verify that the output directory exists: " << output << endl;
+        return -1;
+    }
+    csv << "image,status,x,y,width,height,area,ms" << endl;
+
+    if(workers > 0) {
+        setNumThreads(workers);
+    }
+
+    int crops = 0;
+    int64 start = getTickCount();
+    vector<BatchResult> results(BATCH_CHUNK_SIZE);
+    for(int offset=0; offset < (int)files.size(); offset += BATCH_CHUNK_SIZE) {
+        int count = min(BATCH_CHUNK_SIZE, (int)files.size() - offset);
+        parallel_for_(Range(0, count), BatchWorkers(files, offset, output, redLut, results));
+
+        for(int i=0; i < count; ++i) {
+            const BatchResult &result = results.at(i);
+            csv << files.at(offset + i) << "," << result.status << "," << result.box.x << "," << result.box.y << ","
+                << result.box.width << "," << result.box.height << "," << result.area << "," << result.ms << "\n";
+            crops += result.status == "crop" ? 1 : 0;
+        }
+        csv.flush();
+        cerr << "Processed " << offset + count << "/" << files.size() << " images" << endl;
+    }
+
+    double seconds = (getTickCount() - start) / getTickFrequency();
+    cerr << "Extracted " << crops << " signs from " << files.size() << " images in " << seconds << " s ("
+         << files.size() / seconds << " images/s, " << getNumThreads() << " threads)" << endl;
+
+    return csv.good() ? 0 : -1;
+}
@@ -0,0 +1,29 @@
+#ifndef SESSIE_2_BATCH_H
+#define SESSIE_2_BATCH_H
+
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include "colorlut.h"
+#include "blobs.h"
+#include "morphology.h"
+
+using namespace std;
+using namespace cv;
+
+#define BATCH_CLOSING_ITER 5 // connect blobs, same as the interactive segmentation
+#define BATCH_MIN_BLOB_AREA 64 // pixels, smaller blobs are noise instead of a sign
+#define BATCH_CHUNK_SIZE 256 // images per parallel_for_, the CSV is written after every chunk
+#define BATCH_CSV "boxes.csv"
+#define BATCH_CROP_SUFFIX "_sign.png" // <image>.<extension>_sign.png, skipped when globbing
+#define BATCH_EXTENSIONS ".bmp.jpeg.jpg.png.ppm.tif.tiff.webp." // lower case, separated by dots
+
+typedef struct BatchResult {
+    string status; // crop, none or error
+    Rect box;
+    int area;
+    double ms;
+} BatchResult;
+
+int runBatch(const string &directory, const string &output, const ColorLut &redLut, int workers);
+
+#endif //SESSIE_2_BATCH_H
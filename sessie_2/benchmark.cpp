@@ -0,0 +1,303 @@
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include "colorlut.h"
+#include "huerange.h"
+#include "blobs.h"
+#include "bitmask.h"
+#include "morphology.h"
+#include "timing.h"
+
+using namespace std;
+using namespace cv;
+
+#define CLOSING_ITER 5 // same as main.cpp
+
+// Red in HSV: 330 to 360 degrees and 0 to 10 degrees, same bounds as main.cpp
+const HueRange red = createHueRange(165, 5, 115, 255, 115, 255, 145);
+ColorLut redLut;
+
+// main.cpp before the circular hue range: cvtColor(), 2 inRange() passes with their original bounds and a merge pass
+void redTwoRanges(const Mat &signImg, Mat &mask) {
+    Mat hsv, upper, lower;
+    cvtColor(signImg, hsv, COLOR_BGR2HSV);
+    inRange(hsv, Scalar(165, 115, 115), Scalar(180, 255, 255), upper);
+    inRange(hsv, Scalar(0, 115, 145), Scalar(5, 255, 255), lower);
+    addWeighted(upper, 1.0, lower, 1.0, 0.0, mask);
+}
+
+// cvtColor() and a single pass with the wrapped hue range
+void redHueRange(const Mat &signImg, Mat &mask) {
+    Mat hsv;
+    cvtColor(signImg, hsv, COLOR_BGR2HSV);
+    hueRangeMask(hsv, red, mask);
+}
+
+// Conversion and range test fused into a colour lookup table, compiled once in main()
+void redLookupTable(const Mat &signImg, Mat &mask) {
+    applyColorLut(redLut, signImg, mask);
+}
+
+// main.cpp before the component statistics: contourArea() of the winner and its hull are recomputed in every iteration
+void biggestBlobContours(const Mat &mask, Mat &hullMask) {
+    vector< vector<Point> > contours;
+    findContours(mask.clone(), contours, RETR_EXTERNAL, CHAIN_APPROX_NONE);
+    hullMask = Mat::zeros(mask.size(), CV_8UC1);
+    if(contours.empty()) {
+        return;
+    }
+    vector<Point> hull;
+    convexHull(contours[0], hull);
+    vector<Point> biggest_blob = hull;
+    for(size_t i=0; i < contours.size(); i++) {
+        if(contourArea(contours[i]) > contourArea(biggest_blob)) {
+            convexHull(contours[i], hull);
+            biggest_blob = hull;
+        }
+    }
+    vector< vector<Point> > temp(1, biggest_blob);
+    drawContours(hullMask, temp, -1, 255, -1);
+}
+
+// Component statistics in one pass, only the hull of the biggest blob
+void biggestBlobStatistics(const Mat &mask, Mat &hullMask) {
+    Blob biggest;
+    hullMask = Mat::zeros(mask.size(), CV_8UC1);
+    if(findLargestBlob(mask, biggest)) {
+        vector< vector<Point> > temp(1, biggest.hull);
+        drawContours(hullMask, temp, -1, 255, -1);
+    }
+}
+
+// main.cpp before the packed morphology: closing with 8 bit images
+void closingOpenCV(const Mat &mask, Mat &closed) {
+    morphologyEx(mask, closed, MORPH_CLOSE, Mat(), Point(-1, -1), CLOSING_ITER);
+}
+
+// Closing on the bit-packed mask: one (2N+1)x(2N+1) pass per operation, 64 pixels per word
+void closingPacked(const Mat &mask, Mat &closed) {
+    closeMask(mask, closed, CLOSING_ITER);
+}
+
+// Operands of the mask operations, packed once in main(): a packed mask stays packed between the operations
+Mat otherMask;
+BitMask packedMask, packedOther, packedResult;
+vector<int> packedCounts;
+
+// Mask operations on 8 bit masks
+void andOpenCV(const Mat &mask, Mat &result) {
+    bitwise_and(mask, otherMask, result);
+}
+
+void orOpenCV(const Mat &mask, Mat &result) {
+    bitwise_or(mask, otherMask, result);
+}
+
+void notOpenCV(const Mat &mask, Mat &result) {
+    bitwise_not(mask, result);
+}
+
+void countOpenCV(const Mat &mask, Mat &result) {
+    result = Mat(1, 1, CV_32SC1, Scalar(countNonZero(mask)));
+}
+
+// Sums of 255 per pixel, the packed projections are scaled before the comparison
+void rowsOpenCV(const Mat &mask, Mat &result) {
+    reduce(mask, result, 1, REDUCE_SUM, CV_32S);
+}
+
+void columnsOpenCV(const Mat &mask, Mat &result) {
+    reduce(mask, result, 0, REDUCE_SUM, CV_32S);
+}
+
+// Mask operations on the packed masks, the mask argument is only there for timeImplementation(): the results stay in
+// packedResult and packedCounts, unpacked after the timing by the matching *Result() function
+void andPacked(const Mat &, Mat &) {
+    andBitMask(packedMask, packedOther, packedResult);
+}
+
+void orPacked(const Mat &, Mat &) {
+    orBitMask(packedMask, packedOther, packedResult);
+}
+
+void notPacked(const Mat &, Mat &) {
+    notBitMask(packedMask, packedResult);
+}
+
+void countPacked(const Mat &, Mat &) {
+    packedCounts.assign(1, countBitMask(packedMask));
+}
+
+void rowsPacked(const Mat &, Mat &) {
+    projectBitMaskRows(packedMask, packedCounts);
+}
+
+void columnsPacked(const Mat &, Mat &) {
+    projectBitMaskColumns(packedMask, packedCounts);
+}
+
+void maskResult(Mat &result) {
+    unpackBitMask(packedResult, result);
+}
+
+void countResult(Mat &result) {
+    Mat(packedCounts).copyTo(result);
+}
+
+void rowsResult(Mat &result) {
+    result = Mat(packedCounts) * 255;
+}
+
+void columnsResult(Mat &result) {
+    result = Mat(packedCounts).reshape(1, 1) * 255;
+}
+
+int main(int argc, const char** argv) {
+    CommandLineParser parser(argc, argv,
+                             "{ help h usage ? |    | Shows this message.}"
+                             "{ sign s         |    | Loads a color image with a traffic sign <REQUIRED> }"
+                             "{ scale          | 4  | Resize factor of the image, small images fit in the cache }"
+                             "{ iterations i   | 20 | Number of measured calls per implementation }"
+                             "{ noise n        | 0.05 | Fraction of noise pixels added to the red mask for the biggest blob search }"
+    );
+
+    // Help printing
+    if(parser.has("help") || argc <= 1) {
+        cerr << "Please use absolute paths when supplying your images." << endl;
+        parser.printMessage();
+        return 0;
+    }
+
+    // Parser fail
+    if (!parser.check())
+    {
+        parser.printErrors();
+        return -1;
+    }
+
+    // Required arguments supplied?
+    string sign(parser.get<string>("sign"));
+    double scale = parser.get<double>("scale");
+    int iterations = parser.get<int>("iterations");
+    double noise = parser.get<double>("noise");
+    if(sign.empty() || scale <= 0 || iterations <= 0 || noise < 0 || noise > 1)
+    {
+        cerr << "Please supply your images using command line arguments: --sign=sign.jpg --scale=4 --iterations=20 --noise=0.05" << endl;
+        return -1;
+    }
+
+    // Try to load images
+    Mat signImg;
+    signImg = imread(sign, IMREAD_COLOR);
+
+    if(signImg.empty()) {
+        cerr << "Loading images failed, please verify the paths to the images." << endl;
+        return -1;
+    }
+    resize(signImg, signImg, Size(), scale, scale, INTER_LINEAR);
+
+    int64 start = getTickCount();
+    compileHueRangeLut(redLut, red);
+    cerr << "Compiled the red lookup table in " << (getTickCount() - start) * 1000.0 / getTickFrequency() << " ms" << endl;
+
+    // All implementations must give the same mask as the 2 inRange() passes
+    const char *names[] = {"two-ranges", "hue-range", "lut"};
+    BenchmarkImplementation implementations[] = {redTwoRanges, redHueRange, redLookupTable};
+    Mat reference;
+    bool identical = true;
+
+    printBenchmarkHeader();
+    for(int i = 0; i < 3; i++) {
+        Mat mask;
+        double ms = timeImplementation(implementations[i], signImg, mask, iterations);
+        if(reference.empty()) {
+            reference = mask;
+        }
+        bool same = countNonZero(mask != reference) == 0;
+        identical = identical && same;
+
+        printBenchmarkRow(names[i], signImg, iterations, ms, same);
+    }
+
+    // Biggest blob search on the red mask with salt noise: thousands of small blobs around the sign
+    Mat noisyMask, noiseImg(signImg.size(), CV_32FC1);
+    randu(noiseImg, 0, 1);
+    noisyMask = reference | (noiseImg < noise);
+
+    // The contour loop selects the blob with the biggest hull area, the statistics the blob with the most pixels: on a
+    // noisy mask they can select another blob, so these rows only report if the hulls are the same
+    const char *blobNames[] = {"biggest-blob-contours", "biggest-blob-statistics"};
+    BenchmarkImplementation blobImplementations[] = {biggestBlobContours, biggestBlobStatistics};
+    Mat blobReference;
+    for(int i = 0; i < 2; i++) {
+        Mat hullMask;
+        double ms = timeImplementation(blobImplementations[i], noisyMask, hullMask, iterations);
+        if(blobReference.empty()) {
+            blobReference = hullMask;
+        }
+        bool same = countNonZero(hullMask != blobReference) == 0;
+
+        printBenchmarkRow(blobNames[i], signImg, iterations, ms, same);
+    }
+
+    // Closing of the noisy mask
+    const char *closingNames[] = {"closing-opencv", "closing-packed"};
+    BenchmarkImplementation closingImplementations[] = {closingOpenCV, closingPacked};
+    Mat closingReference;
+    for(int i = 0; i < 2; i++) {
+        Mat closed;
+        double ms = timeImplementation(closingImplementations[i], noisyMask, closed, iterations);
+        if(closingReference.empty()) {
+            closingReference = closed;
+        }
+        bool same = countNonZero(closed != closingReference) == 0;
+        identical = identical && same;
+
+        printBenchmarkRow(closingNames[i], signImg, iterations, ms, same);
+    }
+
+    // Mask operations on the noisy mask and a random mask: OpenCV on 8 bit masks against the packed masks
+    Mat otherNoise(signImg.size(), CV_32FC1);
+    randu(otherNoise, 0, 1);
+    otherMask = otherNoise < 0.5;
+    packBitMask(noisyMask, packedMask);
+    packBitMask(otherMask, packedOther);
+
+    const char *maskNames[] = {"and-opencv", "and-packed", "or-opencv", "or-packed", "not-opencv", "not-packed",
+                               "count-opencv", "count-packed", "rows-opencv", "rows-packed", "columns-opencv", "columns-packed"};
+    BenchmarkImplementation maskImplementations[] = {andOpenCV, andPacked, orOpenCV, orPacked, notOpenCV, notPacked,
+                                                     countOpenCV, countPacked, rowsOpenCV, rowsPacked, columnsOpenCV, columnsPacked};
+    void (*maskResults[])(Mat&) = {maskResult, maskResult, maskResult, countResult, rowsResult, columnsResult};
+    Mat maskReference;
+    for(int i = 0; i < 12; i++) {
+        Mat result;
+        double ms = timeImplementation(maskImplementations[i], noisyMask, result, iterations);
+        bool same = true;
+        if(i % 2 == 0) {
+            maskReference = result;
+        }
+        else {
+            maskResults[i / 2](result);
+            same = result.size() == maskReference.size() && countNonZero(result != maskReference) == 0;
+        }
+        identical = identical && same;
+
+        printBenchmarkRow(maskNames[i], signImg, iterations, ms, same);
+    }
+
+    // The packed operations may write to one of their operands
+    BitMask aliased = packedOther;
+    andBitMask(packedMask, aliased, aliased);
+    andBitMask(packedMask, packedOther, packedResult);
+    identical = identical && aliased.bits == packedResult.bits;
+    aliased = packedOther;
+    orBitMask(packedMask, aliased, aliased);
+    orBitMask(packedMask, packedOther, packedResult);
+    identical = identical && aliased.bits == packedResult.bits;
+
+    if(!identical) {
+        cerr << "The masks of the implementations differ!" << endl;
+        return -2;
+    }
+
+    return 0;
+}
@@ -1,49 +1,159 @@
 #include <iostream>
+#include <fstream>
+#include <cstring>
 #include <opencv2/opencv.hpp>
+#include "colorlut.h"
+#include "huerange.h"
+#include "blobs.h"
+#include "morphology.h"
+#include "batch.h"
 
 using namespace std;
 using namespace cv;
+
+#define TUNER_PREVIEW_WIDTH 1280 // larger images are tuned on a downscaled preview
+#define TUNER_CLOSING_ITER 5 // connect blobs, more times than removing noise
+#define TUNER_MAX_CLOSING_ITER 20
+
 const int max_value_H = 360/2;
 const int max_value = 255;
 const String window_trackbar_name = "Draw contours with trackbar";
 int low_H = 0, low_S = 0, low_V = 0;
 int high_H = max_value_H, high_S = max_value, high_V = max_value;
+int closing_iter = TUNER_CLOSING_ITER;
 
-static void on_low_H_thresh_trackbar(int, void *)
-{
-    low_H = min(high_H-1, low_H);
-    setTrackbarPos("Low H", window_trackbar_name, low_H);
-}
-static void on_high_H_thresh_trackbar(int, void *)
+/*
+ * State of the trackbar tuner, every stage keeps its result together with the parameters it was computed with:
+ * the threshold only depends on the HSV range, the closing and the contours only on the threshold and closing_iter.
+ */
+typedef struct Tuner {
+    Mat preview; // BGR
+    double scale; // preview width / image width, <= 1
+    Mat hsv;
+    bool valid;
+    HueRange range;
+    Mat threshold;
+    int closing;
+    Mat closed;
+    Mat result;
+} Tuner;
+
+Tuner tuner;
+
+static void updateTuner();
+
+// Hue is circular: Low H > High H selects a range around red, so the hue trackbars don't limit each other
+static void on_H_thresh_trackbar(int, void *)
 {
-    high_H = max(high_H, low_H+1);
-    setTrackbarPos("High H", window_trackbar_name, high_H);
+    updateTuner();
 }
 static void on_low_S_thresh_trackbar(int, void *)
 {
     low_S = min(high_S-1, low_S);
     setTrackbarPos("Low S", window_trackbar_name, low_S);
+    updateTuner();
 }
 static void on_high_S_thresh_trackbar(int, void *)
 {
     high_S = max(high_S, low_S+1);
     setTrackbarPos("High S", window_trackbar_name, high_S);
+    updateTuner();
 }
 static void on_low_V_thresh_trackbar(int, void *)
 {
     low_V = min(high_V-1, low_V);
     setTrackbarPos("Low V", window_trackbar_name, low_V);
+    updateTuner();
 }
 static void on_high_V_thresh_trackbar(int, void *)
 {
     high_V = max(high_V, low_V+1);
     setTrackbarPos("High V", window_trackbar_name, high_V);
+    updateTuner();
+}
+
+static void on_closing_trackbar(int, void *)
+{
+    updateTuner();
+}
+
+/*
+ * Recomputes the stages of the tuner whose parameters changed since the last call and shows the result. Trackbar
+ * callbacks call this function, nothing is computed while the trackbars don't move.
+ *
+ * @author Dylan Van Assche
+ */
+static void updateTuner()
+{
+    if(tuner.preview.empty()) {
+        return; // trackbars are being created
+    }
+
+    // 1. Threshold, only when the HSV range changed
+    HueRange range = createHueRange(low_H, high_H, low_S, high_S, low_V, high_V);
+    bool thresholdChanged = !tuner.valid || memcmp(&range, &tuner.range, sizeof(HueRange)) != 0;
+    if(thresholdChanged) {
+        hueRangeMask(tuner.hsv, range, tuner.threshold); // thresholding on 3 channels using trackbars, in a single pass
+        tuner.range = range;
+    }
+
+    // 2. Closing, only when the threshold or the number of iterations changed. The trackbar counts iterations on the full
+    //    image, the gaps they close are scaled down with the preview (at least 1 iteration when the closing is enabled).
+    if(!thresholdChanged && closing_iter == tuner.closing) {
+        return;
+    }
+    int previewIterations = closing_iter > 0 ? max(cvRound(closing_iter * tuner.scale), 1) : 0;
+    closeMask(tuner.threshold, tuner.closed, previewIterations); // connect blobs: dilate, then erode to fix the dilate data loss
+    tuner.closing = closing_iter;
+    tuner.valid = true;
+
+    // 3. Convex hull of the biggest blob, drawn on top of the closed mask
+    Mat mask = tuner.closed.clone();
+    Blob biggest;
+    if(findLargestBlob(tuner.closed, biggest)) {
+        vector< vector<Point> > hulls(1, biggest.hull);
+        drawContours(mask, hulls, -1, 255, -1);
+    }
+
+    tuner.result = Mat::zeros(tuner.preview.size(), CV_8UC3);
+    tuner.preview.copyTo(tuner.result, mask);
+    imshow(window_trackbar_name, tuner.result);
+}
+
+/*
+ * Loads the colour lookup table of the fixed red range.
+ * Set upper and lower boundaries: 330 to 360 degrees and 0 to 10 degrees (red in HSV) as one hue range which wraps
+ * around, saturation at least 115, intensity at least 115 for 330 to 360 degrees and 145 for 0 to 10 degrees.
+ * The range is compiled into one colour lookup table: the BGR to HSV conversion and the wrapped range test become a
+ * single table lookup per pixel. The table only depends on the range, so it can be cached between runs. The cached
+ * file stores the key of the range it was compiled from, it's recompiled when the range changes.
+ *
+ * @param string lutPath, cache file or empty
+ * @param ColorLut redLut output
+ * @author Dylan Van Assche
+ */
+static void loadRedLut(const string &lutPath, ColorLut &redLut) {
+    const HueRange red = createHueRange(165, 5, 115, 255, 115, 255, 145);
+    if(lutPath.empty() || !loadColorLut(lutPath, redLut, hueRangeLutKey(red))) {
+        if(!lutPath.empty() && ifstream(lutPath.c_str()).good()) {
+            cerr << "The lookup table was compiled for another range or version, recompiling: " << lutPath << endl;
+        }
+        compileHueRangeLut(redLut, red);
+
+        if(!lutPath.empty() && !saveColorLut(lutPath, redLut)) {
+            cerr << "Saving the lookup table failed: " << lutPath << endl;
+        }
+    }
 }
 
 int main(int argc, const char** argv) {
     CommandLineParser parser(argc, argv,
                              "{ help h usage ? | | Shows this message.}"
                              "{ sign s        | | Loads a color image with a traffic sign <REQUIRED> }"
+                             "{ lut l         | | Caches the compiled HSV lookup table in this file }"
+                             "{ batch b       | | Extracts the signs of all images in this directory without windows }"
+                             "{ output o      | . | Output directory of the batch crops and boxes.csv }"
+                             "{ workers w     | 0 | Number of batch worker threads, 0 = OpenCV default }"
     );
 
     // Help printing
@@ -60,6 +170,14 @@ int main(int argc, const char** argv) {
         return -1;
     }
 
+    // Headless batch mode
+    string batch(parser.get<string>("batch"));
+    if(!batch.empty()) {
+        ColorLut redLut;
+        loadRedLut(parser.get<string>("lut"), redLut);
+        return runBatch(batch, parser.get<string>("output"), redLut, parser.get<int>("workers"));
+    }
+
     // Required arguments supplied?
     string sign(parser.get<string>("sign"));
     if(sign.empty())
@@ -102,32 +220,15 @@ int main(int argc, const char** argv) {
     imshow("Sign segmented using BGR", rgbSegmentedImg);
     waitKey(0); // Wait for key input to continue
 
-    Mat hsvSegmentedImgUpper, hsvSegmentedImgLower, hsvSegmentedImgMerged;
-    Mat convertedToHSVImg;
-    const int low_H1 = 0; // Set upper and lower boundaries
-    const int low_S1 = 115;
-    const int low_V1 = 145;
-    const int low_H2 = 5; // Set upper and lower boundaries
-    const int low_S2 = 255;
-    const int low_V2 = 255;
-    const int high_H1 = 165;
-    const int high_S1 = 115;
-    const int high_V1 = 115;
-    const int high_H2 = 180;
-    const int high_S2 = 255;
-    const int high_V2 = 255;
-    // Convert from BGR to HSV colorspace
-    cvtColor(signImg, convertedToHSVImg, COLOR_BGR2HSV);
-    inRange(convertedToHSVImg, Scalar(low_H1, low_S1, low_V1), Scalar(low_H2, low_S2, low_V2), hsvSegmentedImgUpper); // thresholding on 3 channels for 170 degrees to 180 degrees (red in HSV), saturation and intensity at least 90 or higher
-    inRange(convertedToHSVImg, Scalar(high_H1, high_S1, high_V1), Scalar(high_H2, high_S2, high_V2), hsvSegmentedImgLower); // thresholding on 3 channels for 0 to 10 degrees (red in HSV), saturation and intensity at least 90 or higher
-
-    // Merge 2 results
-    addWeighted(hsvSegmentedImgUpper, 1.0, hsvSegmentedImgLower, 1.0, 0.0, hsvSegmentedImgMerged); // Same weights
+    Mat hsvSegmentedImgMerged;
+    ColorLut redLut;
+    loadRedLut(parser.get<string>("lut"), redLut);
+    applyColorLut(redLut, signImg, hsvSegmentedImgMerged);
 
     /*
      * HSV color space
      * Advantages: Easy to segment properly a specified color using Hue, use GIMP to figure out the S and V values and convert them to OpenCV using a Python script (see folder sessie_2/gimpHSVtoOpencv.py)
-     * Disadvantages: A bit more difficult to think in this different color space, red requires 2 operations since it's laying around the border of the Hue.
+     * Disadvantages: A bit more difficult to think in this different color space, red is laying around the border of the Hue (a hue range which wraps around, see lib/huerange.cpp).
      *
      * HSV is a better solution for this since you can select only the Hue of the color, in BGR is red a combination of R and a bit of B and G.
      */
@@ -137,93 +238,79 @@ int main(int argc, const char** argv) {
     waitKey(0); // Wait for key input to continue
 
     // Connect blobs to improve segmentation
-    dilate(hsvSegmentedImgMerged, hsvSegmentedImgMerged, Mat(), Point(-1, -1), 5); // connect blobs, more times than removing noise
-    erode(hsvSegmentedImgMerged, hsvSegmentedImgMerged, Mat(), Point(-1, -1), 5); // fix dilate data loss
+    closeMask(hsvSegmentedImgMerged, hsvSegmentedImgMerged, TUNER_CLOSING_ITER); // connect blobs: dilate, then erode to fix the dilate data loss
 
     namedWindow("Sign segmented using HSV connected", WINDOW_AUTOSIZE);
     imshow("Sign segmented using HSV connected", hsvSegmentedImgMerged);
     waitKey(0); // Wait for key input to continue
 
-    // Convex hull approach -> contours
-    vector< vector<Point> > contours;
-    // Find contours of a binary image.
-    findContours(hsvSegmentedImgMerged.clone(), contours, RETR_EXTERNAL, CHAIN_APPROX_NONE); // explain defines
-    vector<Point> hull;
-    convexHull(contours[0], hull);
-    vector<Point> biggest_blob = hull;
-    for(size_t i=0; i < contours.size(); i++) {
-        if(contourArea(contours[i]) > contourArea(biggest_blob)) {
-            convexHull(contours[i], hull); // Improve contouring
-            biggest_blob = hull;
-        }
+    // Convex hull approach -> biggest blob
+    // Component statistics (area, bounding box, centroid) of all blobs in one pass, only the hull of the biggest blob is
+    // computed (see lib/blobs.cpp)
+    Blob biggest_blob;
+    if(!findLargestBlob(hsvSegmentedImgMerged, biggest_blob)) {
+        cerr << "No red blobs found with the fixed range, use the trackbars to tune it." << endl;
     }
-    vector < vector<Point> > temp;
-    Rect box = boundingRect(biggest_blob); // Fetch bounding box for biggest contour
-    temp.push_back(biggest_blob);
+    else {
+        vector < vector<Point> > temp;
+        Rect box = biggest_blob.box; // Fetch bounding box for biggest blob
+        temp.push_back(biggest_blob.hull);
 
-    // input image, contours, contourIdx (-1 = draw all contours), color, thickness (< 0, draw contour interiors), lineType, hierarchy, maxLevel, offset
-    drawContours(hsvSegmentedImgMerged, temp, -1, 255, -1);
+        // input image, contours, contourIdx (-1 = draw all contours), color, thickness (< 0, draw contour interiors), lineType, hierarchy, maxLevel, offset
+        drawContours(hsvSegmentedImgMerged, temp, -1, 255, -1);
 
-    Mat contouredImg = Mat::zeros(signImg.size(), CV_8UC3);
-    signImg.copyTo(contouredImg, hsvSegmentedImgMerged);
-    rectangle(contouredImg, box, cv::Scalar(0, 255, 0)); // Draw bounding box on contoured image with color green
-    namedWindow("Draw contours", WINDOW_AUTOSIZE);
-    imshow("Draw contours", contouredImg);
-    waitKey(0);
+        Mat contouredImg = Mat::zeros(signImg.size(), CV_8UC3);
+        signImg.copyTo(contouredImg, hsvSegmentedImgMerged);
+        rectangle(contouredImg, box, cv::Scalar(0, 255, 0)); // Draw bounding box on contoured image with color green
+        namedWindow("Draw contours", WINDOW_AUTOSIZE);
+        imshow("Draw contours", contouredImg);
+        waitKey(0);
 
-    Mat contouredBoxImg = Mat::zeros(box.size(), contouredImg.type()); //zeros(box.size(), contouredImg.type());;
-    Mat ROI(contouredImg, box);
-    ROI.copyTo(contouredBoxImg);
+        Mat contouredBoxImg = Mat::zeros(box.size(), contouredImg.type()); //zeros(box.size(), contouredImg.type());;
+        Mat ROI(contouredImg, box);
+        ROI.copyTo(contouredBoxImg);
 
-    namedWindow("Draw contours boxed", WINDOW_AUTOSIZE);
-    imshow("Draw contours boxed", contouredBoxImg);
+        namedWindow("Draw contours boxed", WINDOW_AUTOSIZE);
+        imshow("Draw contours boxed", contouredBoxImg);
+    }
 
     // Add trackbars to select the right threshold in an easy way
-    namedWindow("Draw contours with trackbar", WINDOW_AUTOSIZE);
-    createTrackbar("Low H", window_trackbar_name, &low_H, max_value_H, on_low_H_thresh_trackbar);
-    createTrackbar("High H", window_trackbar_name, &high_H, max_value_H, on_high_H_thresh_trackbar);
+    // The tuner works on a preview of at most TUNER_PREVIEW_WIDTH pixels wide, so it stays responsive for large images
+    if(signImg.cols > TUNER_PREVIEW_WIDTH) {
+        tuner.scale = (double)TUNER_PREVIEW_WIDTH / signImg.cols;
+        resize(signImg, tuner.preview, Size(), tuner.scale, tuner.scale, INTER_AREA);
+        cerr << "Tuning on a preview scaled by " << tuner.scale << ", the closing iterations are full resolution values"
+             << endl;
+    }
+    else {
+        tuner.scale = 1.0;
+        tuner.preview = signImg;
+    }
+    cvtColor(tuner.preview, tuner.hsv, COLOR_BGR2HSV);
+    tuner.valid = false;
+
+    namedWindow(window_trackbar_name, WINDOW_AUTOSIZE);
+    createTrackbar("Low H", window_trackbar_name, &low_H, max_value_H, on_H_thresh_trackbar);
+    createTrackbar("High H", window_trackbar_name, &high_H, max_value_H, on_H_thresh_trackbar);
     createTrackbar("Low S", window_trackbar_name, &low_S, max_value, on_low_S_thresh_trackbar);
     createTrackbar("High S", window_trackbar_name, &high_S, max_value, on_high_S_thresh_trackbar);
     createTrackbar("Low V", window_trackbar_name, &low_V, max_value, on_low_V_thresh_trackbar);
     createTrackbar("High V", window_trackbar_name, &high_V, max_value, on_high_V_thresh_trackbar);
-    cvtColor(signImg, convertedToHSVImg, COLOR_BGR2HSV);
-    Mat hsvSegmentedImg;
+    createTrackbar("Closing", window_trackbar_name, &closing_iter, TUNER_MAX_CLOSING_ITER, on_closing_trackbar);
+    updateTuner();
 
+    // The trackbar callbacks recompute the result, the main loop only waits for the user to quit
     while (true) {
-        inRange(convertedToHSVImg, Scalar(low_H, low_S, low_V), Scalar(high_H, high_S, high_V), hsvSegmentedImg); // thresholding on 3 channels using trackbars
-
-        // Connect blobs to improve segmentation
-        dilate(hsvSegmentedImg, hsvSegmentedImg, Mat(), Point(-1, -1), 5); // connect blobs, more times than removing noise
-        erode(hsvSegmentedImg, hsvSegmentedImg, Mat(), Point(-1, -1), 5); // fix dilate data loss
-
-        // Convex hull approach -> contours
-        vector< vector<Point> > contours;
-        // Find contours of a binary image.
-        findContours(hsvSegmentedImg.clone(), contours, RETR_EXTERNAL, CHAIN_APPROX_NONE); // explain defines
-        convexHull(contours[0], hull);
-        vector<Point> biggest_blob = hull;
-        for(size_t i=0; i < contours.size(); i++) {
-            if(contourArea(contours[i]) > contourArea(biggest_blob)) {
-                convexHull(contours[i], hull); // Improve contouring
-                biggest_blob = hull;
-            }
-        }
-        vector < vector<Point> > temp;
-        temp.push_back(biggest_blob);
-
-        // input image, contours, contourIdx (-1 = draw all contours), color, thickness (< 0, draw contour interiors), lineType, hierarchy, maxLevel, offset
-        drawContours(hsvSegmentedImgMerged, temp, -1, 255, -1); // check docs -1
-
-        Mat contouredImg(signImg.size(), CV_8UC3);
-        signImg.copyTo(contouredImg, hsvSegmentedImg);
-        // Show the frames
-        imshow(window_trackbar_name, contouredImg);
-        char key = (char) waitKey(1);
-        if (key == 'q' || key == 'Q' || key == 27) // ESC
+        char key = (char) waitKey(0);
+        if (key == 'q' || key == 'Q' || key == 27 || key == -1) // ESC or all windows closed
         {
             break;
         }
     }
 
+    // Tuned values for the full resolution image
+    cout << "H " << low_H << "-" << high_H << ", S " << low_S << "-" << high_S << ", V " << low_V << "-" << high_V
+         << ", closing " << closing_iter << " iterations" << endl;
+
     return 0;
 }
\ No newline at end of file
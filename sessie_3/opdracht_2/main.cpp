@@ -14,6 +14,22 @@ Mat templateImg;
 int matchMethod = DEFAULT_MATCHING_METHOD;
 int thresholdValue = DEFAULT_THRESHOLD_VALUE;
 
+/*
+ * Score map of matchTemplate() with the images and method it was computed for. The threshold trackbar only changes
+ * the peak extraction, so moving it reuses the score map instead of matching the whole image again.
+ */
+typedef struct ScoreMap {
+    const uchar *input; // data of inputImg and templateImg
+    const uchar *templ;
+    int method;
+    Mat result; // normalized to 0 - 1, best match = 1
+    double maxVal;
+} ScoreMap;
+
+ScoreMap scoreMap;
+
+static void updateScoreMap();
+
 int main(int argc, const char **argv)
 {
     CommandLineParser parser(argc, argv,
@@ -68,6 +84,7 @@ int main(int argc, const char **argv)
 "Template matching", &matchMethod, 5, matchingFuction); // 0 - 5
 
     // Launch window
+    scoreMap.method = -1;
     matchingFuction(0, NULL);
 
     // Wait for key, windows stay open until a key has been pressed
@@ -76,11 +93,17 @@ int main(int argc, const char **argv)
     return 0;
 }
 
-void matchingFuction(int trackbarPos, void *data)
+/*
+ * Recomputes the score map when the images or the matching method changed since the last call.
+ *
+ * @author Dylan Van Assche
+ */
+static void updateScoreMap()
 {
-    Mat result;
-    double minVal;
-    double maxVal;
+    if(scoreMap.method == matchMethod && scoreMap.input == inputImg.data && scoreMap.templ == templateImg.data) {
+        return;
+    }
+    Mat &result = scoreMap.result;
 
     // Template matching and NCC
     matchTemplate(inputImg, templateImg, result, matchMethod); // Find matches using templates
@@ -93,10 +116,22 @@ void matchingFuction(int trackbarPos, void *data)
     }
 
     // Find maximum or minimum match
-    minMaxLoc(result, &minVal, &maxVal);
+    minMaxLoc(result, NULL, &scoreMap.maxVal);
+
+    scoreMap.input = inputImg.data;
+    scoreMap.templ = templateImg.data;
+    scoreMap.method = matchMethod;
+}
+
+void matchingFuction(int trackbarPos, void *data)
+{
+    // Only a method change needs a new score map, a threshold change only redoes the peak extraction below
+    updateScoreMap();
+    const Mat &result = scoreMap.result;
+    double maxVal = scoreMap.maxVal;
 
     // Threshold image using inRange and convert mask to binary to find multiple matches
-    Mat mask = Mat::zeros(Size(inputImg.cols, inputImg.rows), CV_32FC1);
+    Mat mask;
     inRange(result, maxVal * ((double)thresholdValue/100.0), maxVal, mask);
     mask.convertTo(mask, CV_8UC1);
 
@@ -14,8 +14,36 @@ int thresholdValue = 50;
 int stepAngleValue = 19;
 int maxAngleValue = 360;
 
-vector<Rect> matcher(Mat& src);
-void showDetections(Mat image, vector<Rect> detections, Mat rotationMatrix);
+/*
+ * The template rotated over one angle of the bank. The canvas is large enough for the rotated template, the corners
+ * outside the template are excluded with the mask (or filled with a neutral value, see buildTemplateBank()).
+ */
+typedef struct RotatedTemplate {
+    double angle; // degrees, clockwise
+    Mat templ;
+    Mat mask; // 255 inside the rotated template
+    Mat result; // score map of the last match
+} RotatedTemplate;
+
+/*
+ * Rotated templates for one template, angle set and matching method. The score maps are kept for the image and method
+ * they were computed for, so a threshold change only redoes the peak extraction.
+ */
+typedef struct TemplateBank {
+    const uchar *templ; // data of the template
+    int maxAngle;
+    int steps;
+    int method;
+    const uchar *input; // data of the image of the score maps
+    vector<RotatedTemplate> rotations;
+} TemplateBank;
+
+TemplateBank bank;
+
+bool maskSupported(int method);
+void buildTemplateBank(TemplateBank &bank, const Mat &templ, int maxAngle, int steps, int method);
+vector<RotatedRect> matchRotated(const Mat &image, TemplateBank &bank, double threshold);
+void showDetections(Mat image, const vector<RotatedRect> &detections);
 
 int main(int argc, const char **argv)
 {
@@ -56,15 +84,6 @@ int main(int argc, const char **argv)
         return -1;
     }
 
-    // Try to load images
-    inputImg = imread(inputPath, IMREAD_COLOR);
-    templateImg = imread(templatePath, IMREAD_COLOR);
-
-    if(inputImg.empty() || templateImg.empty()) {
-        cerr << "Loading images failed, please verify the paths to the images." << endl;
-        return -1;
-    }
-
     // Show loaded images
     namedWindow("Input image", WINDOW_AUTOSIZE);
     namedWindow("Template image", WINDOW_AUTOSIZE);
@@ -79,6 +98,7 @@ int main(int argc, const char **argv)
     createTrackbar("0: SQDIFF \n 1: SQDIFF NORMED \n 2: TM CCORR \n 3: TM CCORR NORMED \n 4: TM COEFF \n 5: TM COEFF NORMED",
                    "Template matching rotation invariant", &matchMethod, 5, runner); // 0 - 5
 
+    bank.templ = NULL;
     runner(0, NULL);
 
     // Sleep & do event loop.
@@ -87,103 +107,160 @@ int main(int argc, const char **argv)
     return 0;
 }
 
-vector<Rect> matcher(Mat& src)
+/*
+ * Returns true if matchTemplate() accepts a mask for this method. OpenCV 3 only supports a mask for TM_SQDIFF and
+ * TM_CCORR_NORMED. Checked with OpenCV 5.0.0: all 6 methods accept a mask with the type of the template and give the
+ * same scores as with a single channel mask, older OpenCV 4 releases weren't checked.
+ *
+ * @param int method
+ * @returns bool
+ * @author Dylan Van Assche
+ */
+bool maskSupported(int method)
+{
+#if CV_VERSION_MAJOR >= 4
+    return true;
+#else
+    return method == TM_SQDIFF || method == TM_CCORR_NORMED;
+#endif
+}
+
+/*
+ * Builds the rotated templates for angles 0, max / steps, ..., (steps - 1) * max / steps. Only the small template is
+ * rotated, the image is matched as is. The corners are filled with the mean colour of the template for the TM_CCOEFF
+ * methods (zero after the mean subtraction) and with black for the others, the mask is used when the method supports
+ * it. The mask has the type of the template (3 channels), OpenCV 3 asserts on a single channel mask.
+ *
+ * @param TemplateBank bank output
+ * @param Mat templ
+ * @param int maxAngle, degrees
+ * @param int steps, number of angles
+ * @param int method, matchTemplate() method
+ * @author Dylan Van Assche
+ */
+void buildTemplateBank(TemplateBank &bank, const Mat &templ, int maxAngle, int steps, int method)
 {
-    Mat result;
-    matchTemplate(src, templateImg, result, matchMethod);
+    bool meanFill = method == TM_CCOEFF || method == TM_CCOEFF_NORMED;
+    Scalar fill = meanFill ? mean(templ) : Scalar::all(0);
+    Mat inside(templ.size(), templ.type(), Scalar::all(255));
+    Point2f templCenter(templ.cols / 2.0f, templ.rows / 2.0f);
 
-    if (matchMethod == TM_SQDIFF || matchMethod == TM_SQDIFF_NORMED)
+    bank.rotations.resize(max(steps, 0));
+    for (int i = 0; i < steps; i++)
     {
-        result = 1 - result;
+        RotatedTemplate &rotation = bank.rotations[i];
+        rotation.angle = i*((double)maxAngle/(double)steps);
+
+        // Canvas around the rotated template, the rotation is moved to its center (counterclockwise angle for OpenCV)
+        Rect canvas = RotatedRect(templCenter, templ.size(), (float)rotation.angle).boundingRect();
+        Mat rotationMatrix = getRotationMatrix2D(templCenter, -rotation.angle, 1.0);
+        rotationMatrix.at<double>(0, 2) += canvas.width / 2.0 - templCenter.x;
+        rotationMatrix.at<double>(1, 2) += canvas.height / 2.0 - templCenter.y;
+
+        warpAffine(templ, rotation.templ, rotationMatrix, canvas.size(), INTER_LINEAR, BORDER_CONSTANT, fill);
+        warpAffine(inside, rotation.mask, rotationMatrix, canvas.size(), INTER_NEAREST, BORDER_CONSTANT, Scalar(0));
+        rotation.result.release();
     }
 
-    Mat mask = Mat::zeros(Size(src.cols, src.rows), CV_8UC1);
-    inRange(result, ((double)thresholdValue/100.0), 1, mask);
+    bank.templ = templ.data;
+    bank.maxAngle = maxAngle;
+    bank.steps = steps;
+    bank.method = method;
+    bank.input = NULL;
+}
 
-    vector<Rect> detections;
-    vector<vector<Point> > contours;
-    findContours(mask, contours, CV_RETR_EXTERNAL, CHAIN_APPROX_NONE);
-    for (int i = 0; i < contours.size(); ++i)
+/*
+ * Rotation invariant matching with a template bank: every rotated template is matched with the image, the peaks above
+ * the threshold are returned as oriented boxes of the template size.
+ *
+ * @param Mat image
+ * @param TemplateBank bank, the score maps are reused if the image didn't change
+ * @param double threshold, 0 - 1
+ * @returns vector<RotatedRect> detections
+ * @author Dylan Van Assche
+ */
+vector<RotatedRect> matchRotated(const Mat &image, TemplateBank &bank, double threshold)
+{
+    bool reuse = bank.input == image.data;
+    vector<RotatedRect> detections;
+    for (size_t r = 0; r < bank.rotations.size(); ++r)
     {
-        // Improve contouring and find bounding box
-        vector<Point> hull;
-        convexHull(contours[i], hull);
-        Rect rect = boundingRect(hull);
-
-        // Find local maximum
-        Point loc;
-        minMaxLoc(result(rect), NULL, NULL, NULL, &loc);
-        Point c(loc.x + rect.x, loc.y + rect.y);
-
-        Rect detectedRect(c, c + Point(templateImg.cols, templateImg.rows));
-        detections.push_back(detectedRect);
+        RotatedTemplate &rotation = bank.rotations[r];
+        if (rotation.templ.cols > image.cols || rotation.templ.rows > image.rows)
+        {
+            continue;
+        }
+
+        if (!reuse || rotation.result.empty())
+        {
+            if (maskSupported(bank.method))
+            {
+                matchTemplate(image, rotation.templ, rotation.result, bank.method, rotation.mask);
+            }
+            else
+            {
+                matchTemplate(image, rotation.templ, rotation.result, bank.method);
+            }
+
+            if (bank.method == TM_SQDIFF || bank.method == TM_SQDIFF_NORMED)
+            {
+                rotation.result = 1 - rotation.result;
+            }
+        }
+        const Mat &result = rotation.result;
+
+        Mat mask;
+        inRange(result, threshold, 1, mask);
+
+        vector<vector<Point> > contours;
+        findContours(mask, contours, CV_RETR_EXTERNAL, CHAIN_APPROX_NONE);
+        for (int i = 0; i < contours.size(); ++i)
+        {
+            // Improve contouring and find bounding box
+            vector<Point> hull;
+            convexHull(contours[i], hull);
+            Rect rect = boundingRect(hull);
+
+            // Find local maximum, the center of the rotated template is the center of the detection
+            Point loc;
+            minMaxLoc(result(rect), NULL, NULL, NULL, &loc);
+            Point2f center(loc.x + rect.x + rotation.templ.cols / 2.0f, loc.y + rect.y + rotation.templ.rows / 2.0f);
+            detections.push_back(RotatedRect(center, Size2f(templateImg.cols, templateImg.rows), (float)rotation.angle));
+        }
     }
+    bank.input = image.data;
 
     return detections;
 }
 
-// Visualize detections on the input frame and show in the given window
-// https://github.com/OpenCVBlueprints/OpenCVBlueprints/blob/master/chapter_5/source_code/rotation_invariant_detection/rotation_invariant_object_detection.cpp#L107-L152
-void showDetections(Mat image, vector<Rect> detections, Mat rotationMatrix)
+// Visualize the oriented detections on the input frame
+void showDetections(Mat image, const vector<RotatedRect> &detections)
 {
     RNG rng(123456);
-    vector<Rect> temp = detections;
     Scalar color(rng.uniform(0,255), rng.uniform(0, 255), rng.uniform(0, 255));
-    for( int j = 0; j < (int)temp.size(); j++ ) {
-        // Use a rectangle representation on the frame but warp back the coordinates
-        // Retrieve the 4 corners detected in the rotation image
-        Point p1(temp[j].x, temp[j].y); // Top left
-        Point p2((temp[j].x + temp[j].width), temp[j].y); // Top right
-        Point p3((temp[j].x + temp[j].width), (temp[j].y + temp[j].height)); // Down right
-        Point p4(temp[j].x, (temp[j].y + temp[j].height)); // Down left
-
-        // Add the 4 points to a matrix structure
-        Mat coordinates = (Mat_<double>(3, 4) << p1.x, p2.x, p3.x, p4.x, \
-                                                    p1.y, p2.y, p3.y, p4.y, \
-                                                    1, 1, 1, 1);
-
-        // Apply a new inverse tranformation matrix
-        Mat result = rotationMatrix * coordinates;
-
-        // Retrieve the new coordinates from the tranformed matrix
-        Point p1_back, p2_back, p3_back, p4_back;
-        p1_back.x = (int) result.at<double>(0, 0);
-        p1_back.y = (int) result.at<double>(1, 0);
-
-        p2_back.x = (int) result.at<double>(0, 1);
-        p2_back.y = (int) result.at<double>(1, 1);
-
-        p3_back.x = (int) result.at<double>(0, 2);
-        p3_back.y = (int) result.at<double>(1, 2);
-
-        p4_back.x = (int) result.at<double>(0, 3);
-        p4_back.y = (int) result.at<double>(1, 3);
-
-        // Draw a rotated rectangle by lines, using the reverse warped points
-        line(image, p1_back, p2_back, color, 2);
-        line(image, p2_back, p3_back, color, 2);
-        line(image, p3_back, p4_back, color, 2);
-        line(image, p4_back, p1_back, color, 2);
+    for( int j = 0; j < (int)detections.size(); j++ ) {
+        // Draw a rotated rectangle by lines between its corners
+        Point2f corners[4];
+        detections[j].points(corners);
+        for (int k = 0; k < 4; k++)
+        {
+            line(image, corners[k], corners[(k + 1) % 4], color, 2);
+        }
     }
 }
 
 void runner(int trackbarPos, void *data)
 {
     Mat outputImg(inputImg.clone());
-    Point center;
-    center.x = inputImg.cols / 2;
-    center.y = inputImg.rows / 2;
 
-    // Do detections for each rotation
-    for (int i = 0; i < stepAngleValue; i++)
+    // The rotated templates only depend on the template, the angles and the method (corner fill)
+    if (bank.templ != templateImg.data || bank.maxAngle != maxAngleValue || bank.steps != stepAngleValue || bank.method != matchMethod)
     {
-        // https://github.com/OpenCVBlueprints/OpenCVBlueprints/blob/master/chapter_5/source_code/rotation_invariant_detection/rotation_invariant_object_detection.cpp#L36-L42
-        double angle = i*((double)maxAngleValue/(double)stepAngleValue);
-        Mat rotatedImg;
-        warpAffine(inputImg, rotatedImg, getRotationMatrix2D(center, angle, 1.0), inputImg.size());
-        vector<Rect> detections = matcher(rotatedImg);
-        showDetections(outputImg, detections, getRotationMatrix2D(center, -angle, 1.0));
+        buildTemplateBank(bank, templateImg, maxAngleValue, stepAngleValue, matchMethod);
     }
 
+    vector<RotatedRect> detections = matchRotated(inputImg, bank, (double)thresholdValue/100.0);
+    showDetections(outputImg, detections);
+
     imshow("Template matching rotation invariant", outputImg);
 }
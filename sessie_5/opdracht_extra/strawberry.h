@@ -3,6 +3,8 @@
 
 #include <iostream>
 #include <opencv2/opencv.hpp>
+#include "colorlut.h"
+#include "morphology.h"
 
 using namespace std;
 using namespace cv;
@@ -15,6 +17,7 @@ using namespace cv;
 #define ML_CLOSING_ITER 3
 #define SVM_ITER 100
 #define SVM_EPSILON 1e-6
+#define ML_LUT_BITS 6 // 64 levels per channel, 2^18 predictions per classifier
 
 void runner(int trackbarPos, void *data);
 void mouse(int event, int x, int y, int flags, void* userdata);